@@ -106,6 +106,8 @@ typedef union stp_mxml_value_u		/**** An XML node value. ****/
 
 typedef struct stp_mxml_node_s stp_mxml_node_t;	/**** An XML node. ****/
 
+typedef struct stp_mxml_arena_s stp_mxml_arena_t; /**** Storage for a loaded document. ****/
+
 struct stp_mxml_node_s			/**** An XML node. ****/
 {
   stp_mxml_type_t	type;			/* Node type */
@@ -115,6 +117,7 @@ struct stp_mxml_node_s			/**** An XML node. ****/
   stp_mxml_node_t	*child;			/* First child node */
   stp_mxml_node_t	*last_child;		/* Last child node */
   stp_mxml_value_t	value;			/* Node value */
+  stp_mxml_arena_t	*arena;			/* Arena holding the node, or NULL */
 };
 
 
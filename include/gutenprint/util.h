@@ -110,6 +110,23 @@ extern void stp_set_global_dbgdata(void *val);
  */
 extern void * stp_get_global_dbgdata(void);
 
+/**
+ * Set the number of threads the library may use to process a page,
+ * counting the calling thread.  The default is 1, which starts no
+ * threads, unless the STP_THREADS environment variable says otherwise.
+ * Output does not depend on the thread count.  This may be called
+ * prior to stp_init(), but not while a page is being printed.
+ * @param count number of threads; anything below 1 is taken as 1.
+ */
+extern void stp_set_thread_count(int count);
+
+/**
+ * Get the number of threads the library may use to process a page.
+ * This may be called prior to stp_init().
+ * @returns the thread count; always 1 without thread support.
+ */
+extern int stp_get_thread_count(void);
+
 /**
  * Set the output encoding.  This function sets the encoding that all
  * strings translated by gettext are output in.  It is a wrapper
@@ -28,6 +28,15 @@
 #include <errno.h>
 #include <signal.h>
 #include <strings.h>  /* For strncasecmp */
+#ifndef _WIN32
+#include <poll.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 
 #define BACKEND_VERSION "0.126G"
 
@@ -61,6 +70,11 @@ int stats_only = 0;
 FILE *logger;
 
 const char *corrtable_path = CORRTABLE_PATH;
+#ifdef CORRTABLE_CACHE_PATH
+const char *cache_path = CORRTABLE_CACHE_PATH;
+#else
+const char *cache_path = NULL;
+#endif
 static int max_xfer_size = URB_XFER_SIZE;
 static int xfer_timeout = XFER_TIMEOUT;
 
@@ -233,15 +247,21 @@ char *dict_find(const char *key, int dlen, struct deviceid_dict* dict)
 int read_data(struct dyesub_connection *conn, uint8_t *buf, int buflen, int *readlen)
 {
 	int ret;
+	double start = dyesub_bench_now();
 
 	/* Clear buffer */
 	memset(buf, 0, buflen);
 
-	ret = libusb_bulk_transfer(conn->dev, conn->endp_up,
-				   buf,
-				   buflen,
-				   readlen,
-				   xfer_timeout);
+	if (conn->sim)
+		ret = dyesub_sim_read(conn->sim, buf, buflen, readlen);
+	else
+		ret = libusb_bulk_transfer(conn->dev, conn->endp_up,
+					   buf,
+					   buflen,
+					   readlen,
+					   xfer_timeout);
+
+	dyesub_bench_add(BENCH_XFER, start);
 
 	if (ret < 0) {
 		ERROR("Failure to receive data from printer (libusb error %d: (%d/%d from 0x%02x))\n", ret, *readlen, buflen, conn->endp_up);
@@ -276,6 +296,7 @@ done:
 int send_data(struct dyesub_connection *conn, const uint8_t *buf, int len)
 {
 	int num = 0;
+	double start = dyesub_bench_now();
 
 	if (dyesub_debug) {
 		DEBUG("Sending %d bytes to printer\n", len);
@@ -301,18 +322,26 @@ int send_data(struct dyesub_connection *conn, const uint8_t *buf, int len)
 			DEBUG2("\n");
 		}
 
-		int ret = libusb_bulk_transfer(conn->dev, conn->endp_down,
-					       (uint8_t*) buf, len2,
-					       &num, xfer_timeout);
+		int ret;
+
+		if (conn->sim)
+			ret = dyesub_sim_write(conn->sim, buf, len2, &num);
+		else
+			ret = libusb_bulk_transfer(conn->dev, conn->endp_down,
+						   (uint8_t*) buf, len2,
+						   &num, xfer_timeout);
 
 		if (ret < 0) {
 			ERROR("Failure to send data to printer (libusb error %d: (%d/%d to 0x%02x))\n", ret, num, len2, conn->endp_down);
+			dyesub_bench_add(BENCH_XFER, start);
 			return ret;
 		}
 		len -= num;
 		buf += num;
 	}
 
+	dyesub_bench_add(BENCH_XFER, start);
+
 	return CUPS_BACKEND_OK;
 }
 
@@ -1048,6 +1077,10 @@ void print_help(const char *argv0, const struct dyesub_backend *backend)
 		int i;
 		DEBUG("Environment variables:\n");
 		DEBUG(" DYESUB_DEBUG EXTRA_PID EXTRA_VID EXTRA_TYPE BACKEND SERIAL OLD_URI_SCHEME BACKEND_QUIET\n");
+		DEBUG(" BACKEND_SIMULATE SIM_LATENCY SIM_BANDWIDTH BACKEND_BENCHMARK CORRTABLE_CACHE\n");
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+		DEBUG(" BACKEND_DAEMON BACKEND_DAEMON_SOCKET\n");
+#endif
 		DEBUG("CUPS Usage:\n");
 		DEBUG("\tDEVICE_URI=someuri %s job user title num-copies options [ filename ]\n", ptr);
 		DEBUG("\n");
@@ -1136,39 +1169,22 @@ static int parse_cmdstream(const struct dyesub_backend *backend, void *backend_c
 	return CUPS_BACKEND_OK;
 }
 
-static int handle_input(struct dyesub_backend *backend, void *backend_ctx,
-			const char *fname, const char *uri, const char *type)
+static int handle_input_fd(struct dyesub_backend *backend, void *backend_ctx,
+			   int data_fd, const char *type, int copies)
 {
 	int ret = CUPS_BACKEND_OK;
 	int i;
 	const void *jobs[MAX_JOBS_FROM_READ_PARSE];
-	int data_fd = fileno(stdin);
 	int read_page = 0, print_page = 0;
 	struct dyesub_joblist *jlist = NULL;
+	double bench_start, bench_image;
 
-	if (!fname) {
-		if (uri && strlen(uri))
-			ERROR("ERROR: No input file specified\n");
-		ret = CUPS_BACKEND_FAILED;
-		goto done;
-	}
-
-	if (ncopies < 1) {
+	if (copies < 1) {
 		ERROR("ERROR: need to have at least 1 copy!\n");
 		ret = CUPS_BACKEND_FAILED;
 		goto done;
 	}
 
-	/* Open file if not STDIN */
-	if (strcmp("-", fname)) {
-		data_fd = open(fname, O_RDONLY);
-		if (data_fd < 0) {
-			perror("ERROR:Can't open input file");
-			ret = CUPS_BACKEND_FAILED;
-			goto done;
-		}
-	}
-
 #ifndef _WIN32
 	/* Ensure we're using BLOCKING I/O */
 	i = fcntl(data_fd, F_GETFL, 0);
@@ -1184,10 +1200,6 @@ static int handle_input(struct dyesub_backend *backend, void *backend_ctx,
 		ret = CUPS_BACKEND_FAILED;
 		goto done;
 	}
-
-	/* Ignore SIGPIPE */
-	signal(SIGPIPE, SIG_IGN);
-	signal(SIGTERM, sigterm_handler);
 #endif
 
 	/* See if it's a CUPS command stream, and if yes, handle it! */
@@ -1199,7 +1211,7 @@ static int handle_input(struct dyesub_backend *backend, void *backend_ctx,
 	}
 
 	/* Time for the main processing loop */
-	INFO("Printing started (%d copies)\n", ncopies);
+	INFO("Printing started (%d copies)\n", copies);
 
 	/* Emit a verbose marker dump */
 	ret = query_markers(backend, backend_ctx, 1);
@@ -1211,7 +1223,13 @@ newpage:
 	for (i = 0 ; i < MAX_JOBS_FROM_READ_PARSE ; i++)
 		jobs[i] = NULL;
 
-	if ((ret = backend->read_parse(backend_ctx, jobs, data_fd, ncopies))) {
+	bench_start = dyesub_bench_now();
+	bench_image = dyesub_bench_total(BENCH_IMAGE);
+	ret = backend->read_parse(backend_ctx, jobs, data_fd, copies);
+	/* Image processing done while parsing is accounted separately */
+	dyesub_bench_add(BENCH_PARSE, bench_start +
+			 (dyesub_bench_total(BENCH_IMAGE) - bench_image));
+	if (ret) {
 		if (read_page)
 			goto done_multiple;
 		else
@@ -1225,7 +1243,7 @@ newpage:
 
 	/* Create a joblist if needed */
 	if (!jlist) {
-		jlist = dyesub_joblist_create(backend, backend_ctx);
+		jlist = dyesub_joblist_create(backend, backend_ctx, copies);
 	}
 	if (!jlist) {
 		for (i = 0 ; i < MAX_JOBS_FROM_READ_PARSE ; i++)
@@ -1240,7 +1258,7 @@ newpage:
 	}
 	read_page++;
 
-	INFO("Parsed page %d (%d copies)\n", read_page, ncopies);
+	INFO("Parsed page %d (%d copies)\n", read_page, copies);
 
 	/* If we get here, we can wait for another combined job, do so */
 	if (dyesub_joblist_canwait(jlist))
@@ -1264,8 +1282,6 @@ done_multiple:
 	if (jlist)
 		goto print_list;
 
-	close(data_fd);
-
 	ret = CUPS_BACKEND_OK;
 
 done:
@@ -1274,6 +1290,650 @@ done:
 	return ret;
 }
 
+static int handle_input(struct dyesub_backend *backend, void *backend_ctx,
+			const char *fname, const char *uri, const char *type)
+{
+	int data_fd = fileno(stdin);
+	int ret;
+
+	if (!fname) {
+		if (uri && strlen(uri))
+			ERROR("ERROR: No input file specified\n");
+		return CUPS_BACKEND_FAILED;
+	}
+
+	/* Open file if not STDIN */
+	if (strcmp("-", fname)) {
+		data_fd = open(fname, O_RDONLY);
+		if (data_fd < 0) {
+			perror("ERROR:Can't open input file");
+			return CUPS_BACKEND_FAILED;
+		}
+	}
+
+#ifndef _WIN32
+	/* Ignore SIGPIPE.  The daemon sets these up itself, once, before
+	   starting any workers. */
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGTERM, sigterm_handler);
+#endif
+
+	ret = handle_input_fd(backend, backend_ctx, data_fd, type, ncopies);
+
+	if (data_fd != fileno(stdin))
+		close(data_fd);
+
+	return ret;
+}
+
+static int open_device(struct libusb_device *device, struct dyesub_connection *conn)
+{
+	int ret;
+
+	/* Open an appropriate device */
+	ret = libusb_open(device, &conn->dev);
+	if (ret) {
+		ERROR("Printer open failure (Need to be root?) (%d)\n", ret);
+		return CUPS_BACKEND_RETRY_CURRENT;
+	}
+
+	/* Detach the kernel driver */
+	if (libusb_kernel_driver_active(conn->dev, conn->iface)) {
+		ret = libusb_detach_kernel_driver(conn->dev, conn->iface);
+		if (ret && (ret != LIBUSB_ERROR_NOT_SUPPORTED)) {
+			ERROR("Printer open failure (Could not detach printer from kernel) (%d)\n", ret);
+			ret = CUPS_BACKEND_RETRY_CURRENT;
+			goto done_close;
+		}
+	}
+
+	/* Claim the interface so we can start using this! */
+	ret = backend_claim_interface(conn->dev, conn->iface, NUM_CLAIM_ATTEMPTS);
+	if (ret) {
+		ERROR("Printer open failure (Unable to claim interface) (%d)\n", ret);
+		ret = CUPS_BACKEND_RETRY;
+		goto done_close;
+	}
+
+	/* Use the appropriate altesetting! */
+	if (conn->altset != 0) {
+		ret = libusb_set_interface_alt_setting(conn->dev, conn->iface, conn->altset);
+		if (ret) {
+			ERROR("Printer open failure (Unable to issue altsettinginterface) (%d)\n", ret);
+			ret = CUPS_BACKEND_RETRY;
+			goto done_claimed;
+		}
+	}
+
+	return CUPS_BACKEND_OK;
+
+done_claimed:
+	libusb_release_interface(conn->dev, conn->iface);
+done_close:
+	libusb_close(conn->dev);
+	conn->dev = NULL;
+
+	return ret;
+}
+
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+/*
+   Daemon mode
+
+   One process attaches to every matching printer for a backend, keeps
+   them open (along with whatever state the backend loaded in attach())
+   and accepts jobs over a local socket.  Each job is handed to a worker
+   thread that owns its printer until the job is done, so all of the
+   printers can be kept busy at once.  A job goes to an idle printer
+   that has media, preferring the one that has been idle the longest;
+   if every printer is busy the job waits for one to free up.  Clients
+   are ordinary backend invocations with BACKEND_DAEMON_SOCKET set.
+
+   Protocol:  client sends "JOB <copies> <content-type>\n", followed by
+   the job data, then shuts down its write side.  The daemon replies
+   with "DONE <status>\n", where status is a CUPS_BACKEND_* code.
+*/
+#define MAX_DAEMON_PRINTERS 8
+
+enum {
+	DAEMON_OK = 0,
+	DAEMON_NO_RESPONSE,
+	DAEMON_NEEDS_ATTENTION,
+	DAEMON_NO_MEDIA,
+};
+
+struct daemon_printer {
+	struct dyesub_connection conn;
+	void *ctx;
+	int reported;  /* Last DAEMON_* problem we logged */
+
+	/* Protected by daemon_lock */
+	int busy;      /* A worker owns ctx */
+	time_t last_job;
+	int jobs;
+
+	/* Only touched by the dispatcher */
+	int have_thread;
+	pthread_t thread;
+
+	/* The job handed to the worker */
+	struct dyesub_backend *backend;
+	int fd;
+	int copies;
+	char type[128];
+};
+
+static struct daemon_printer daemon_printers[MAX_DAEMON_PRINTERS];
+static pthread_mutex_t daemon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t daemon_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int daemon_finished;  /* Jobs done, protected by daemon_lock */
+
+static int daemon_read_line(int fd, char *buf, int len)
+{
+	int i = 0;
+
+	/* One byte at a time, so we don't eat any of the job data */
+	while (i < len - 1) {
+		int ret = read(fd, buf + i, 1);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		if (buf[i] == '\n')
+			break;
+		i++;
+	}
+	buf[i] = 0;
+
+	return i;
+}
+
+static void daemon_reply(int fd, int status)
+{
+	char line[32];
+
+	snprintf(line, sizeof(line), "DONE %d\n", status);
+	if (write(fd, line, strlen(line)) < 0)
+		WARNING("Unable to send job status\n");
+	close(fd);
+}
+
+/* Only log a problem with a printer when it first shows up */
+static void daemon_report(struct daemon_printer *p, int problem)
+{
+	int i = p - daemon_printers;
+
+	if (problem == p->reported)
+		return;
+	p->reported = problem;
+
+	switch (problem) {
+	case DAEMON_NO_RESPONSE:
+		WARNING("Printer %d not responding, skipping\n", i);
+		break;
+	case DAEMON_NEEDS_ATTENTION:
+		WARNING("Printer %d needs attention, skipping\n", i);
+		break;
+	case DAEMON_NO_MEDIA:
+		WARNING("Printer %d is out of media, skipping\n", i);
+		break;
+	default:
+		INFO("Printer %d is available again\n", i);
+		break;
+	}
+}
+
+/* Pick an idle printer that has media, preferring the one that has been
+   idle the longest, and mark it busy.  Printers that are (or may soon be)
+   able to take the job later are counted in *waiting, and *finished is
+   set to the number of jobs that had finished when we started looking.
+
+   Asking the printers means USB I/O, so it's done without daemon_lock;
+   workers need the lock to finish up.  Only the dispatcher marks
+   printers busy, so anything idle when we look stays idle (and ours to
+   query) until we claim it. */
+static struct daemon_printer *daemon_pick_printer(const struct dyesub_backend *backend,
+						  int num_printers, int *waiting,
+						  unsigned int *finished)
+{
+	struct daemon_printer *candidates[MAX_DAEMON_PRINTERS];
+	int media[MAX_DAEMON_PRINTERS];
+	int num_candidates = 0;
+	int num_ready = 0;
+	struct daemon_printer *best = NULL;
+	int best_media = -1;
+	int i;
+
+	*waiting = 0;
+
+	pthread_mutex_lock(&daemon_lock);
+	*finished = daemon_finished;
+	for (i = 0 ; i < num_printers ; i++) {
+		/* A worker owns this one; don't touch it */
+		if (daemon_printers[i].busy)
+			(*waiting)++;
+		else
+			candidates[num_candidates++] = &daemon_printers[i];
+	}
+	pthread_mutex_unlock(&daemon_lock);
+
+	for (i = 0 ; i < num_candidates ; i++) {
+		struct daemon_printer *p = candidates[i];
+		struct marker *markers = NULL;
+		int marker_count = 0;
+		int level = -1;
+		int j;
+
+		/* The printer may still be busy with an earlier job (eg with
+		   FAST_RETURN set), or be in need of attention */
+		if (backend->query_state) {
+			int state = backend->query_state(p->ctx);
+
+			if (state == PRINTER_STATE_BUSY) {
+				(*waiting)++;
+				continue;
+			} else if (state != PRINTER_STATE_IDLE) {
+				daemon_report(p, DAEMON_NEEDS_ATTENTION);
+				continue;
+			}
+		}
+
+		/* Printers that can't report status are skipped */
+		if (backend->query_markers &&
+		    backend->query_markers(p->ctx, &markers, &marker_count)) {
+			daemon_report(p, DAEMON_NO_RESPONSE);
+			continue;
+		}
+
+		for (j = 0 ; j < marker_count ; j++) {
+			if (markers[j].levelnow == 0)
+				break;
+			if (markers[j].levelnow > 0 &&
+			    (level < 0 || markers[j].levelnow < level))
+				level = markers[j].levelnow;
+		}
+		if (j < marker_count) {
+			daemon_report(p, DAEMON_NO_MEDIA);
+			continue;
+		}
+		daemon_report(p, DAEMON_OK);
+
+		candidates[num_ready] = p;
+		media[num_ready++] = level;
+	}
+
+	/* last_job is only stable under the lock */
+	pthread_mutex_lock(&daemon_lock);
+	for (i = 0 ; i < num_ready ; i++) {
+		struct daemon_printer *p = candidates[i];
+
+		if (!best || p->last_job < best->last_job ||
+		    (p->last_job == best->last_job && media[i] > best_media)) {
+			best = p;
+			best_media = media[i];
+		}
+	}
+	if (best)
+		best->busy = 1;
+	pthread_mutex_unlock(&daemon_lock);
+
+	return best;
+}
+
+static void *daemon_worker(void *arg)
+{
+	struct daemon_printer *p = arg;
+	int ret;
+
+	ret = handle_input_fd(p->backend, p->ctx, p->fd,
+			      strcmp(p->type, "-") ? p->type : NULL,
+			      p->copies);
+	daemon_reply(p->fd, ret);
+
+	pthread_mutex_lock(&daemon_lock);
+	p->last_job = time(NULL);
+	p->jobs++;
+	p->busy = 0;
+	daemon_finished++;
+	pthread_cond_signal(&daemon_cond);
+	pthread_mutex_unlock(&daemon_lock);
+
+	return NULL;
+}
+
+static int daemon_serve(struct dyesub_backend *backend, int num_printers,
+			const char *path)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	sigset_t sigs, oldsigs;
+	int sock;
+	int i;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		ERROR("Socket path too long (%s)\n", path);
+		return CUPS_BACKEND_FAILED;
+	}
+	strcpy(addr.sun_path, path);
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		ERROR("Can't create socket: %s\n", strerror(errno));
+		return CUPS_BACKEND_FAILED;
+	}
+	unlink(path);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sock, 4)) {
+		ERROR("Can't listen on '%s': %s\n", path, strerror(errno));
+		close(sock);
+		return CUPS_BACKEND_FAILED;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sigterm_handler;
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	/* Workers run with these blocked, so they always land here */
+	sigemptyset(&sigs);
+	sigaddset(&sigs, SIGTERM);
+	sigaddset(&sigs, SIGINT);
+
+	INFO("Daemon listening on '%s' with %d printer(s)\n", path, num_printers);
+
+	while (!terminate) {
+		struct daemon_printer *p;
+		struct pollfd pfd;
+		char line[256];
+		char type[128];
+		int copies = 1;
+		unsigned int finished;
+		int waiting;
+		int fd;
+
+		/* Unlike accept(), poll() is never restarted after a signal */
+		pfd.fd = sock;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR("Poll failed: %s\n", strerror(errno));
+			break;
+		}
+
+		fd = accept(sock, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR("Accept failed: %s\n", strerror(errno));
+			break;
+		}
+
+		type[0] = 0;
+		if (daemon_read_line(fd, line, sizeof(line)) < 0 ||
+		    sscanf(line, "JOB %d %127s", &copies, type) < 1) {
+			WARNING("Malformed job request\n");
+			close(fd);
+			continue;
+		}
+
+		/* Wait for a printer to free up.  Workers wake us when they
+		   finish, but a printer that is busy on its own can only be
+		   noticed by asking it again. */
+		while (!(p = daemon_pick_printer(backend, num_printers,
+						 &waiting, &finished)) &&
+		       waiting && !terminate) {
+			struct timespec ts;
+
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec++;
+			/* Don't sleep through a worker that finished while
+			   we were asking the printers */
+			pthread_mutex_lock(&daemon_lock);
+			if (daemon_finished == finished)
+				pthread_cond_timedwait(&daemon_cond, &daemon_lock, &ts);
+			pthread_mutex_unlock(&daemon_lock);
+		}
+		if (p)
+			INFO("Dispatching job to printer %d (%d jobs so far)\n",
+			     (int)(p - daemon_printers), p->jobs);
+
+		if (!p) {
+			ERROR("No printers available!\n");
+			daemon_reply(fd, CUPS_BACKEND_RETRY);
+			continue;
+		}
+
+		/* Reap the worker that ran the previous job */
+		if (p->have_thread)
+			pthread_join(p->thread, NULL);
+
+		p->backend = backend;
+		p->fd = fd;
+		p->copies = copies;
+		strcpy(p->type, type[0] ? type : "-");
+
+		pthread_sigmask(SIG_BLOCK, &sigs, &oldsigs);
+		p->have_thread = !pthread_create(&p->thread, NULL, daemon_worker, p);
+		pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+		if (!p->have_thread) {
+			ERROR("Unable to start printer worker\n");
+			daemon_reply(fd, CUPS_BACKEND_RETRY);
+			pthread_mutex_lock(&daemon_lock);
+			p->busy = 0;
+			pthread_mutex_unlock(&daemon_lock);
+		}
+	}
+
+	close(sock);
+	unlink(path);
+
+	/* Let any jobs still in flight finish */
+	for (i = 0 ; i < num_printers ; i++) {
+		if (daemon_printers[i].have_thread)
+			pthread_join(daemon_printers[i].thread, NULL);
+	}
+
+	return CUPS_BACKEND_OK;
+}
+
+static int daemon_main(const char *argv0, struct dyesub_backend *backend,
+		       int simulate, const char *path)
+{
+	struct libusb_device **list = NULL;
+	int num_printers = 0;
+	int ret = CUPS_BACKEND_OK;
+	int i, j;
+
+	/* The benchmark totals are shared, and would be raced on by the
+	   printer workers */
+	dyesub_benchmark = 0;
+
+	if (simulate) {
+		/* BACKEND_SIMULATE=N gives us N identical printers */
+		for (i = 0 ; i < simulate && i < MAX_DAEMON_PRINTERS ; i++) {
+			struct dyesub_connection *conn = &daemon_printers[i].conn;
+
+			conn->type = lookup_printer_type(backend, extra_vid, extra_pid);
+			conn->usb_vid = extra_vid;
+			conn->usb_pid = extra_pid;
+			conn->sim = dyesub_sim_create(backend, conn->type);
+			if (!conn->sim)
+				break;
+			num_printers++;
+		}
+	} else {
+		int num = libusb_get_device_list(NULL, &list);
+
+		for (i = 0 ; i < num && num_printers < MAX_DAEMON_PRINTERS ; i++) {
+			struct dyesub_connection *conn = &daemon_printers[num_printers].conn;
+			struct libusb_device_descriptor desc;
+
+			libusb_get_device_descriptor(list[i], &desc);
+
+			for (j = 0 ; backend->devices[j].vid ; j++) {
+				if (desc.idVendor == backend->devices[j].vid &&
+				    desc.idProduct == backend->devices[j].pid)
+					break;
+			}
+			if (!backend->devices[j].vid)
+				continue;
+
+			if (probe_device(list[i], &desc, backend->devices[j].make,
+					 argv0, backend->devices[j].manuf_str,
+					 i, NUM_CLAIM_ATTEMPTS, 0, NULL,
+					 conn, backend) == -1)
+				continue;
+
+			if (open_device(list[i], conn))
+				continue;
+
+			conn->type = backend->devices[j].type;
+			conn->usb_vid = desc.idVendor;
+			conn->usb_pid = desc.idProduct;
+			num_printers++;
+		}
+	}
+
+	/* Attach the backend to everything we found */
+	for (i = 0 ; i < num_printers ; i++) {
+		struct daemon_printer *p = &daemon_printers[i];
+
+		p->ctx = backend->init();
+		if (!p->ctx ||
+		    backend->attach(p->ctx, &p->conn, rand())) {
+			ERROR("Unable to attach to printer %d!\n", i);
+			ret = CUPS_BACKEND_FAILED;
+			goto done;
+		}
+		INFO("Printer %d attached (bus/port %03d/%03d)\n", i,
+		     p->conn.bus_num, p->conn.port_num);
+	}
+
+	if (!num_printers) {
+		ERROR("Printer open failure (No matching printers found!)\n");
+		ret = CUPS_BACKEND_RETRY;
+		goto done;
+	}
+
+	ret = daemon_serve(backend, num_printers, path);
+
+done:
+	for (i = 0 ; i < num_printers ; i++) {
+		struct daemon_printer *p = &daemon_printers[i];
+
+		if (p->ctx) {
+			if (backend->teardown)
+				backend->teardown(p->ctx);
+			else
+				generic_teardown(p->ctx);
+		}
+		if (p->conn.dev) {
+			libusb_release_interface(p->conn.dev, p->conn.iface);
+			libusb_close(p->conn.dev);
+		}
+		dyesub_sim_destroy(p->conn.sim);
+	}
+
+	if (list)
+		libusb_free_device_list(list, 1);
+
+	return ret;
+}
+
+/* Hand a job off to a running daemon instead of talking to USB directly */
+static int daemon_submit(const char *path, const char *fname, const char *type)
+{
+	struct sockaddr_un addr;
+	uint8_t buf[8192];
+	char line[64];
+	int data_fd = fileno(stdin);
+	int sock;
+	int ret = CUPS_BACKEND_RETRY;
+	int len;
+
+	if (!fname) {
+		ERROR("ERROR: No input file specified\n");
+		return CUPS_BACKEND_FAILED;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		ERROR("Socket path too long (%s)\n", path);
+		return CUPS_BACKEND_FAILED;
+	}
+	strcpy(addr.sun_path, path);
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0 ||
+	    connect(sock, (struct sockaddr *)&addr, sizeof(addr))) {
+		ERROR("Unable to contact backend daemon at '%s': %s\n", path, strerror(errno));
+		STATE("+offline-report\n");
+		if (sock >= 0)
+			close(sock);
+		return CUPS_BACKEND_RETRY;
+	}
+	STATE("-offline-report\n");
+
+	if (strcmp("-", fname)) {
+		data_fd = open(fname, O_RDONLY);
+		if (data_fd < 0) {
+			perror("ERROR:Can't open input file");
+			close(sock);
+			return CUPS_BACKEND_FAILED;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	snprintf(line, sizeof(line), "JOB %d %s\n", ncopies,
+		 (type && *type && !strchr(type, ' ')) ? type : "-");
+	if (write(sock, line, strlen(line)) < 0)
+		goto done;
+
+	while ((len = read(data_fd, buf, sizeof(buf))) != 0) {
+		int wrote = 0;
+
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			ERROR("Data Read Error: %s\n", strerror(errno));
+			ret = CUPS_BACKEND_FAILED;
+			goto done;
+		}
+		while (wrote < len) {
+			int i = write(sock, buf + wrote, len - wrote);
+			if (i < 0) {
+				if (errno == EINTR)
+					continue;
+				ERROR("Lost connection to backend daemon\n");
+				goto done;
+			}
+			wrote += i;
+		}
+	}
+	shutdown(sock, SHUT_WR);
+
+	if (daemon_read_line(sock, line, sizeof(line)) < 0 ||
+	    sscanf(line, "DONE %d", &ret) != 1) {
+		ERROR("No job status from backend daemon\n");
+		ret = CUPS_BACKEND_RETRY;
+	}
+
+done:
+	if (data_fd != fileno(stdin))
+		close(data_fd);
+	close(sock);
+
+	return ret;
+}
+#endif
+
 int main (int argc, char **argv)
 {
 	struct libusb_device **list = NULL;
@@ -1284,6 +1944,11 @@ int main (int argc, char **argv)
 	struct dyesub_connection conn;
 
 	int ret = CUPS_BACKEND_OK;
+	int simulate = 0;
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+	const char *daemon_path = NULL;
+	const char *daemon_socket = NULL;
+#endif
 
 	int found = -1;
 	int jobid = 0;
@@ -1333,11 +1998,29 @@ int main (int argc, char **argv)
 		old_uri = atoi(getenv("OLD_URI_SCHEME"));
 	if (getenv("CORRTABLE_PATH"))
 		corrtable_path = getenv("CORRTABLE_PATH");
+	if (getenv("CORRTABLE_CACHE"))
+		cache_path = getenv("CORRTABLE_CACHE");
+	if (getenv("BACKEND_SIMULATE"))
+		simulate = atoi(getenv("BACKEND_SIMULATE"));
+	if (getenv("BACKEND_BENCHMARK"))
+		dyesub_benchmark = atoi(getenv("BACKEND_BENCHMARK"));
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+	if (getenv("BACKEND_DAEMON"))
+		daemon_path = getenv("BACKEND_DAEMON");
+	if (getenv("BACKEND_DAEMON_SOCKET"))
+		daemon_socket = getenv("BACKEND_DAEMON_SOCKET");
+#endif
 
 	if (test_mode >= TEST_MODE_NOATTACH && (extra_vid == -1 || extra_pid == -1)) {
 		ERROR("Must specify EXTRA_VID, EXTRA_PID in test mode > 1!\n");
 		exit(1);
 	}
+	if (simulate && (extra_vid == -1 || extra_pid == -1)) {
+		ERROR("Must specify EXTRA_VID, EXTRA_PID in simulation mode!\n");
+		exit(1);
+	}
+
+	memset(&conn, 0, sizeof(conn));
 
 	if (stats_only && !dyesub_debug)
 		quiet = 1;
@@ -1433,6 +2116,12 @@ int main (int argc, char **argv)
 		backend_str = NULL;
 	}
 
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+	/* Let a running daemon deal with the printer */
+	if (daemon_socket && uri && strlen(uri) && backend)
+		return daemon_submit(daemon_socket, fname, type);
+#endif
+
 #ifndef LIBUSB_PRE_1_0_10
 	if (dyesub_debug) {
 		const struct libusb_version *ver;
@@ -1457,6 +2146,18 @@ int main (int argc, char **argv)
 		goto done;
 	}
 
+#if !defined(_WIN32) && defined(HAVE_PTHREAD)
+	if (daemon_path && backend && (!uri || !strlen(uri))) {
+		if (test_mode >= TEST_MODE_NOATTACH) {
+			ERROR("Daemon mode not supported in test mode > 1!\n");
+			ret = CUPS_BACKEND_FAILED;
+		} else {
+			ret = daemon_main(argv0, backend, simulate, daemon_path);
+		}
+		goto done;
+	}
+#endif
+
 	/* If we're in standalone mode, print help only if no args */
 	if ((!uri || !strlen(uri)) && !stats_only) {
 		if (argc < 2) {
@@ -1466,6 +2167,19 @@ int main (int argc, char **argv)
 		}
 	}
 
+	/* Simulated printers bypass USB entirely */
+	if (simulate && test_mode < TEST_MODE_NOATTACH) {
+		WARNING("**** SIMULATED PRINTER!\n");
+		conn.sim = dyesub_sim_create(backend,
+					     lookup_printer_type(backend,
+								 extra_vid, extra_pid));
+		if (!conn.sim) {
+			ret = CUPS_BACKEND_FAILED;
+			goto done;
+		}
+		goto bypass;
+	}
+
 	/* Enumerate devices */
 	STATE("+connecting-to-device\n");
 
@@ -1485,41 +2199,10 @@ int main (int argc, char **argv)
 			goto bypass;
 	}
 
-	/* Open an appropriate device */
-	ret = libusb_open(list[found], &conn.dev);
-	if (ret) {
-		ERROR("Printer open failure (Need to be root?) (%d)\n", ret);
-		ret = CUPS_BACKEND_RETRY_CURRENT;
+	/* Open and claim the device */
+	ret = open_device(list[found], &conn);
+	if (ret)
 		goto done;
-	}
-
-	/* Detach the kernel driver */
-	if (libusb_kernel_driver_active(conn.dev, conn.iface)) {
-		ret = libusb_detach_kernel_driver(conn.dev, conn.iface);
-		if (ret && (ret != LIBUSB_ERROR_NOT_SUPPORTED)) {
-			ERROR("Printer open failure (Could not detach printer from kernel) (%d)\n", ret);
-			ret = CUPS_BACKEND_RETRY_CURRENT;
-			goto done_close;
-		}
-	}
-
-	/* Claim the interface so we can start using this! */
-	ret = backend_claim_interface(conn.dev, conn.iface, NUM_CLAIM_ATTEMPTS);
-	if (ret) {
-		ERROR("Printer open failure (Unable to claim interface) (%d)\n", ret);
-		ret = CUPS_BACKEND_RETRY;
-		goto done_close;
-	}
-
-	/* Use the appropriate altesetting! */
-	if (conn.altset != 0) {
-		ret = libusb_set_interface_alt_setting(conn.dev, conn.iface, conn.altset);
-		if (ret) {
-			ERROR("Printer open failure (Unable to issue altsettinginterface) (%d)\n", ret);
-			ret = CUPS_BACKEND_RETRY;
-			goto done_claimed;
-		}
-	}
 
 bypass:
 	STATE("-connecting-to-device\n");
@@ -1529,7 +2212,7 @@ bypass:
 	      backend->name, backend->version);
 	backend_ctx = backend->init();
 
-	if (test_mode < TEST_MODE_NOATTACH) {
+	if (test_mode < TEST_MODE_NOATTACH && !conn.sim) {
 		struct libusb_device *device;
 		struct libusb_device_descriptor desc;
 
@@ -1581,7 +2264,7 @@ bypass:
 	PPD("StpUsbBackend=\"%s\"\n", backend_str ? backend_str : backend->name);
 	PPD("StpUsbVid=%04x\n", conn.usb_vid);
 	PPD("StpUsbPid=%04x\n", conn.usb_pid);
-	if (test_mode < TEST_MODE_NOATTACH) {
+	if (test_mode < TEST_MODE_NOATTACH && !conn.sim) {
 		PPD("StpUsbBus=%03d\n", conn.bus_num);
 		PPD("StpUsbPort=%03d\n", conn.port_num);
 	}
@@ -1597,12 +2280,21 @@ bypass:
 	/* Parse the file passed in */
 	ret = handle_input(backend, backend_ctx, fname, uri, type);
 
+	/* Replay the job if benchmarking (can't rewind stdin) */
+	if (dyesub_benchmark) {
+		int runs = 1;
+
+		if (fname && strcmp("-", fname)) {
+			for ( ; !ret && !terminate && runs < dyesub_benchmark ; runs++)
+				ret = handle_input(backend, backend_ctx, fname, uri, type);
+		}
+		dyesub_bench_report(backend, runs);
+	}
+
 done_claimed:
-	if (test_mode < TEST_MODE_NOATTACH)
+	if (test_mode < TEST_MODE_NOATTACH && !conn.sim)
 		libusb_release_interface(conn.dev, conn.iface);
-
-done_close:
-	if (test_mode < TEST_MODE_NOATTACH)
+	if (test_mode < TEST_MODE_NOATTACH && !conn.sim)
 		libusb_close(conn.dev);
 done:
 
@@ -1618,6 +2310,8 @@ done:
 	if (list)
 		libusb_free_device_list(list, 1);
 
+	dyesub_sim_destroy(conn.sim);
+
 	libusb_exit(NULL);
 
 	return ret;
@@ -1754,6 +2448,160 @@ int dyesub_read_file2(const char *filename, void *databuf, int datalen,
 	return CUPS_BACKEND_OK;
 }
 
+/* Persistent cache of correction tables and other data that is expensive
+   to obtain, shared across backend invocations.  Each entry is a single
+   file consisting of a fixed header followed by the raw payload, so it can
+   be mapped and validated without any parsing. */
+
+#define CACHE_MAGIC   0x43535944  /* "DYSC" */
+#define CACHE_VERSION 1
+#define CACHE_KEY_LEN 116
+
+struct dyesub_cache_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t len;
+	uint32_t crc;
+	char     key[CACHE_KEY_LEN];
+} __attribute__((packed));
+
+uint32_t dyesub_crc32(const uint8_t *buf, size_t len)
+{
+	uint32_t crc = 0xffffffff;
+
+	while (len--) {
+		int i;
+		crc ^= *buf++;
+		for (i = 0 ; i < 8 ; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+static int cache_filename(const char *key, char *buf, int buflen)
+{
+	int i, len;
+
+	if (!cache_path || !*cache_path || !key)
+		return -1;
+
+	len = snprintf(buf, buflen, "%s/", cache_path);
+	if (len < 0 || len >= buflen)
+		return -1;
+
+	/* Sanitize the key so it can't escape the cache directory */
+	for (i = 0 ; key[i] && len < buflen - 5 ; i++) {
+		char c = key[i];
+		if (!isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.')
+			c = '_';
+		buf[len++] = c;
+	}
+	strcpy(buf + len, ".bin");
+
+	return 0;
+}
+
+void *dyesub_cache_load(const char *key, size_t *len, size_t extra)
+{
+#ifndef _WIN32
+	char fname[2048];
+	struct stat st;
+	const struct dyesub_cache_hdr *hdr;
+	void *map;
+	uint8_t *buf = NULL;
+	int fd;
+
+	if (cache_filename(key, fname, sizeof(fname)))
+		return NULL;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*hdr)) {
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	hdr = map;
+	if (le32_to_cpu(hdr->magic) != CACHE_MAGIC ||
+	    le32_to_cpu(hdr->version) != CACHE_VERSION ||
+	    strncmp(hdr->key, key, sizeof(hdr->key)) ||
+	    (off_t)(sizeof(*hdr) + le32_to_cpu(hdr->len)) != st.st_size) {
+		DEBUG("Ignoring stale cache entry '%s'\n", fname);
+		goto done;
+	}
+
+	if (dyesub_crc32((const uint8_t*)map + sizeof(*hdr), le32_to_cpu(hdr->len)) != le32_to_cpu(hdr->crc)) {
+		WARNING("Cache entry '%s' is corrupt, ignoring\n", fname);
+		goto done;
+	}
+
+	buf = malloc(le32_to_cpu(hdr->len) + extra);
+	if (!buf) {
+		ERROR("Memory allocation failure!\n");
+		goto done;
+	}
+	memcpy(buf, (const uint8_t*)map + sizeof(*hdr), le32_to_cpu(hdr->len));
+	memset(buf + le32_to_cpu(hdr->len), 0, extra);
+	*len = le32_to_cpu(hdr->len);
+
+	DEBUG("Loaded %u bytes from cache entry '%s'\n", le32_to_cpu(hdr->len), fname);
+
+done:
+	munmap(map, st.st_size);
+	return buf;
+#else
+	UNUSED(key);
+	UNUSED(len);
+	UNUSED(extra);
+	return NULL;
+#endif
+}
+
+int dyesub_cache_store(const char *key, const void *buf, size_t len)
+{
+	char fname[2048];
+	char tmpname[2100];
+	struct dyesub_cache_hdr hdr;
+	int fd, ret;
+
+	if (cache_filename(key, fname, sizeof(fname)))
+		return CUPS_BACKEND_OK;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = cpu_to_le32(CACHE_MAGIC);
+	hdr.version = cpu_to_le32(CACHE_VERSION);
+	hdr.len = cpu_to_le32(len);
+	hdr.crc = cpu_to_le32(dyesub_crc32(buf, len));
+	strncpy(hdr.key, key, sizeof(hdr.key) - 1);
+
+	/* Write to a temporary file, then atomically move it into place */
+	snprintf(tmpname, sizeof(tmpname), "%s.%d", fname, (int)getpid());
+	fd = open(tmpname, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if (fd < 0) {
+		DEBUG("Unable to create cache entry '%s'\n", tmpname);
+		return CUPS_BACKEND_OK;
+	}
+
+	ret = (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	       write(fd, buf, len) != (ssize_t)len);
+	close(fd);
+
+	if (ret || rename(tmpname, fname)) {
+		WARNING("Unable to write cache entry '%s'\n", fname);
+		unlink(tmpname);
+	}
+
+	return CUPS_BACKEND_OK;
+}
+
 uint16_t uint16_to_packed_bcd(uint16_t val)
 {
         uint16_t bcd;
@@ -1790,7 +2638,7 @@ uint32_t packed_bcd_to_uint32(const char *in, int len)
 }
 
 /* Job list manipulation */
-struct dyesub_joblist *dyesub_joblist_create(const struct dyesub_backend *backend, void *ctx)
+struct dyesub_joblist *dyesub_joblist_create(const struct dyesub_backend *backend, void *ctx, int copies)
 {
 	struct dyesub_joblist *list;
 
@@ -1804,7 +2652,7 @@ struct dyesub_joblist *dyesub_joblist_create(const struct dyesub_backend *backen
 	list->num_entries = 0;
 
 	if (collate)
-		list->copies = ncopies;
+		list->copies = copies;
 	else
 		list->copies = 1;
 
@@ -2017,7 +2865,9 @@ int dyesub_joblist_print(const struct dyesub_joblist *list, int *pagenum)
 				/* Print this page */
 				if (test_mode < TEST_MODE_NOPRINT ||
 				    list->backend->flags & BACKEND_FLAG_DUMMYPRINT) {
+					double start = dyesub_bench_now();
 					ret = list->backend->main_loop(list->ctx, list->entries[j], wait_on_return);
+					dyesub_bench_add(BENCH_PAGE, start);
 					if (ret)
 						return ret;
 				}
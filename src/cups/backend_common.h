@@ -192,6 +192,13 @@ struct marker {
 	int numtype; /* Numerical type, (-1 for unknown) */
 };
 
+/* Printer readiness, as returned by query_state */
+enum {
+	PRINTER_STATE_IDLE = 0,  /* Ready to accept a job right away */
+	PRINTER_STATE_BUSY,      /* Printing, warming up, cooling down.. */
+	PRINTER_STATE_ERROR,     /* Needs attention, or not responding */
+};
+
 #define DECKS_MAX 2
 struct printerstats {
 	time_t timestamp;
@@ -225,6 +232,29 @@ struct dyesub_connection {
 	// TODO:  mutex/lock
 
 	int type; /* P_XXXX */
+
+	struct dyesub_sim *sim; /* Non-NULL if talking to a simulated printer */
+};
+
+/* Simulated printer, used for benchmarking without hardware */
+#define SIM_RESP_MAX 4096
+
+struct dyesub_sim {
+	int type;  /* P_XXXX */
+	int (*reply)(struct dyesub_sim *sim, const uint8_t *buf, int len);
+
+	long latency;   /* Per-transfer latency, in us */
+	long bandwidth; /* Bytes per second, 0 for unlimited */
+
+	uint32_t data_remaining;  /* Payload bytes to swallow */
+	int state;                /* For use by backend reply hook */
+
+	uint8_t resp[SIM_RESP_MAX];
+	int resp_len;
+	int resp_pos;
+
+	uint64_t bytes_out;
+	uint64_t bytes_in;
 };
 
 #define DYESUB_MAX_JOB_ENTRIES 3
@@ -262,6 +292,11 @@ int dyesub_read_file2(const char *filename, void *databuf, int datalen,
 #define dyesub_read_file(__fname, __databuf, __datalen, __actual_len) \
 	dyesub_read_file2(__fname, __databuf, __datalen, __actual_len, 0)
 
+/* Persistent table cache */
+uint32_t dyesub_crc32(const uint8_t *buf, size_t len);
+void *dyesub_cache_load(const char *key, size_t *len, size_t extra);
+int dyesub_cache_store(const char *key, const void *buf, size_t len);
+
 uint16_t uint16_to_packed_bcd(uint16_t val);
 uint32_t packed_bcd_to_uint32(const char *in, int len);
 
@@ -272,8 +307,31 @@ void generic_teardown(void *vctx);
 int backend_claim_interface(struct libusb_device_handle *dev, int iface,
 			    int num_claim_attempts);
 
+/* Simulated printer */
+struct dyesub_sim *dyesub_sim_create(const struct dyesub_backend *backend, int type);
+void dyesub_sim_destroy(struct dyesub_sim *sim);
+int dyesub_sim_write(struct dyesub_sim *sim, const uint8_t *buf, int len, int *num);
+int dyesub_sim_read(struct dyesub_sim *sim, uint8_t *buf, int buflen, int *num);
+int dyesub_sim_respond(struct dyesub_sim *sim, const void *buf, int len);
+
+/* Benchmark accounting */
+enum {
+	BENCH_PARSE = 0,
+	BENCH_IMAGE,
+	BENCH_XFER,
+	BENCH_PAGE,
+	BENCH_MAX,
+};
+
+extern int dyesub_benchmark;
+
+double dyesub_bench_now(void);
+void dyesub_bench_add(int which, double start);
+double dyesub_bench_total(int which);
+void dyesub_bench_report(const struct dyesub_backend *backend, int runs);
+
 /* Job list manipulation */
-struct dyesub_joblist *dyesub_joblist_create(const struct dyesub_backend *backend, void *ctx);
+struct dyesub_joblist *dyesub_joblist_create(const struct dyesub_backend *backend, void *ctx, int copies);
 int dyesub_joblist_appendjob(struct dyesub_joblist *list, const void *job);
 void dyesub_joblist_cleanup(const struct dyesub_joblist *list);
 int dyesub_joblist_print(const struct dyesub_joblist *list, int *pagenum);
@@ -308,6 +366,8 @@ struct dyesub_backend {
 	int  (*query_serno)(struct dyesub_connection *conn, char *buf, int buf_len); /* Optional */
 	int  (*query_markers)(void *ctx, struct marker **markers, int *count);
 	int  (*query_stats)(void *ctx, struct printerstats *stats); /* Optional */
+	int  (*query_state)(void *ctx); /* Optional, returns PRINTER_STATE_* */
+	int  (*sim_reply)(struct dyesub_sim *sim, const uint8_t *buf, int len); /* Optional */
 	const struct device_id devices[];
 };
 
@@ -323,6 +383,7 @@ extern int collate;
 extern int test_mode;
 extern int quiet;
 extern const char *corrtable_path;
+extern const char *cache_path;
 extern FILE *logger;
 extern int stats_only;
 
@@ -1447,8 +1447,8 @@ static int dnpds40_attach(void *vctx, struct dyesub_connection *conn, uint8_t jo
 			return CUPS_BACKEND_FAILED;
 		}
 
-		/* Figure out actual Manufacturer */
-		{
+		/* Figure out actual Manufacturer (unknown if simulated) */
+		if (ctx->conn->dev) {
 			struct libusb_device_descriptor desc;
 			struct libusb_device *udev;
 
@@ -4508,6 +4508,23 @@ static int dnpds40_query_markers(void *vctx, struct marker **markers, int *count
 	return CUPS_BACKEND_OK;
 }
 
+static int dnpds40_query_state(void *vctx)
+{
+	struct dnpds40_ctx *ctx = vctx;
+
+	switch (dnpds40_query_status(ctx)) {
+	case 0:   /* Idle */
+	case 900: /* Standby; main_loop wakes it up */
+		return PRINTER_STATE_IDLE;
+	case 1:   /* Printing */
+	case 500: /* Cooling print head */
+	case 510: /* Cooling paper motor */
+		return PRINTER_STATE_BUSY;
+	default:
+		return PRINTER_STATE_ERROR;
+	}
+}
+
 static int dnp_query_stats(void *vctx, struct printerstats *stats)
 {
 	struct dnpds40_cmd cmd;
@@ -4604,6 +4621,88 @@ static int dnp_job_polarity(void *vctx)
 	return (count & 1);
 }
 
+/* Simulated printer support */
+static int dnpds40_sim_reply(struct dyesub_sim *sim, const uint8_t *buf, int len)
+{
+	const struct dnpds40_cmd *cmd = (const struct dnpds40_cmd *) buf;
+	char arg1[sizeof(cmd->arg1) + 1];
+	char arg2[sizeof(cmd->arg2) + 1];
+	char arg3[sizeof(cmd->arg3) + 1];
+	char resp[64];
+	const char *payload = NULL;
+	int i;
+
+	if (len < (int)sizeof(*cmd) || cmd->esc != 0x1b || cmd->p != 0x50)
+		return 0;
+
+	memcpy(arg1, cmd->arg1, sizeof(cmd->arg1));
+	arg1[sizeof(cmd->arg1)] = 0;
+	memcpy(arg2, cmd->arg2, sizeof(cmd->arg2));
+	arg2[sizeof(cmd->arg2)] = 0;
+	memcpy(arg3, cmd->arg3, sizeof(cmd->arg3));
+	arg3[sizeof(cmd->arg3)] = 0;
+
+	/* Trim the space padding */
+	for (i = sizeof(cmd->arg1) ; i && arg1[i-1] == ' ' ; i--)
+		arg1[i-1] = 0;
+	for (i = sizeof(cmd->arg2) ; i && arg2[i-1] == ' ' ; i--)
+		arg2[i-1] = 0;
+
+	/* Any payload follows the command */
+	sim->data_remaining = atoi(arg3);
+
+	if (!strcmp(arg1, "CNTRL") && !strcmp(arg2, "START")) {
+		sim->state = 1; /* Printing */
+		return sizeof(*cmd);
+	}
+
+	if (!strcmp(arg1, "STATUS")) {
+		payload = sim->state ? "00001" : "00000";
+		sim->state = 0;
+	} else if (!strcmp(arg1, "INFO")) {
+		if (!strcmp(arg2, "SERIAL_NUMBER"))
+			payload = "SIM00001";
+		else if (!strcmp(arg2, "FVER"))
+			payload = "SIM 1.30";
+		else if (!strcmp(arg2, "MEDIA")) {
+			switch (sim->type) {
+			case P_DNP_DS80:
+			case P_DNP_DS80D:
+			case P_DNP_DS820:
+				payload = "MED 510";
+				break;
+			case P_DNP_DSRX1:
+				payload = "MED 310";
+				break;
+			default:
+				payload = "MED 400";
+				break;
+			}
+		} else if (!strcmp(arg2, "FREE_PBUFFER"))
+			payload = "FBP02";
+		else if (!strcmp(arg2, "MLOT"))
+			payload = "SIMLOT";
+		else if (!strcmp(arg2, "RESOLUTION_V"))
+			payload = "RV0334";
+		else if (!strcmp(arg2, "RESOLUTION_H"))
+			payload = "RH0300";
+		else if (!strcmp(arg2, "MEDIA_OFFSET"))
+			payload = "00000050";
+		else
+			payload = "00000300";  /* Counters, quantities, etc */
+	} else if (!strcmp(arg1, "MNT_RD") || !strcmp(arg1, "TBL_RD")) {
+		payload = "00000300";
+	}
+
+	/* Everything else is a command without a response */
+	if (payload) {
+		snprintf(resp, sizeof(resp), "%08d%s\r", (int)strlen(payload) + 1, payload);
+		dyesub_sim_respond(sim, resp, strlen(resp));
+	}
+
+	return sizeof(*cmd);
+}
+
 static const char *dnpds40_prefixes[] = {
 	"dnp_citizen", "dnpds40",  // Family names, do *not* nuke.
 	// backwards compatibility
@@ -4627,8 +4726,10 @@ const struct dyesub_backend dnpds40_backend = {
 	.query_serno = dnpds40_query_serno,
 	.query_markers = dnpds40_query_markers,
 	.query_stats = dnp_query_stats,
+	.query_state = dnpds40_query_state,
 	.combine_jobs = dnp_combine_jobs,
 	.job_polarity = dnp_job_polarity,
+	.sim_reply = dnpds40_sim_reply,
 	.devices = {
 		{ 0x1343, 0x0003, P_DNP_DS40, NULL, "dnp-ds40"},
 		{ 0x1343, 0x0003, P_DNP_DS40, NULL, "citizen-cx"}, /* Duplicate */
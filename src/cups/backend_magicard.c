@@ -30,6 +30,10 @@
 
 #include <time.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* Gamma tables computed with this perl program:
 
   my $input_bpp = 8;
@@ -451,70 +455,154 @@ static void magicard_cleanup_job(const void *vjob)
 	free((void*)job);
 }
 
+/* Each 672-pixel row is split into six bit-planes (LSB first) of 84 bytes
+   each per color, plus an optional 84-byte resin black plane.  Pixels are
+   packed MSB first. */
+#define MAGICARD_ROW_PIXELS   672
+#define MAGICARD_PLANE_STRIDE (MAGICARD_ROW_PIXELS / 8)
+#define MAGICARD_ROW_STRIDE   (MAGICARD_PLANE_STRIDE * 6)
+
+#ifdef __SSE2__
+/* Reverse the byte order within each 64-bit half, so that movemask
+   hands back the first pixel of each group of eight in the MSB. */
+static inline __m128i magicard_swap8(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+/* Pack up to 16 pixels (6bpp) into 'len' bytes of each output plane */
+static void magicard_pack16(const uint8_t *y, const uint8_t *m, const uint8_t *c,
+			    uint8_t *y_o, uint8_t *m_o, uint8_t *c_o, uint8_t *k_o,
+			    int len)
+{
+	int j;
+#ifdef __SSE2__
+	const __m128i max = _mm_set1_epi8(0x3f);
+	__m128i vy = _mm_loadu_si128((const __m128i*)y);
+	__m128i vm = _mm_loadu_si128((const __m128i*)m);
+	__m128i vc = _mm_loadu_si128((const __m128i*)c);
+	int bits;
+
+	/* Extract "true black" from ymc data, if enabled */
+	if (k_o) {
+		__m128i k = _mm_and_si128(_mm_cmpeq_epi8(vy, max),
+					  _mm_and_si128(_mm_cmpeq_epi8(vm, max),
+							_mm_cmpeq_epi8(vc, max)));
+		vy = _mm_andnot_si128(k, vy);
+		vm = _mm_andnot_si128(k, vm);
+		vc = _mm_andnot_si128(k, vc);
+
+		bits = _mm_movemask_epi8(magicard_swap8(k));
+		k_o[0] = bits;
+		if (len > 1)
+			k_o[1] = bits >> 8;
+	}
+
+	vy = magicard_swap8(vy);
+	vm = magicard_swap8(vm);
+	vc = magicard_swap8(vc);
+
+	/* Shift bit j up into each byte's MSB and collect them */
+	for (j = 0 ; j < 6 ; j++) {
+		__m128i shift = _mm_cvtsi32_si128(7 - j);
+		int off = j * MAGICARD_PLANE_STRIDE;
+
+		bits = _mm_movemask_epi8(_mm_sll_epi16(vy, shift));
+		y_o[off] = bits;
+		if (len > 1)
+			y_o[off + 1] = bits >> 8;
+		bits = _mm_movemask_epi8(_mm_sll_epi16(vm, shift));
+		m_o[off] = bits;
+		if (len > 1)
+			m_o[off + 1] = bits >> 8;
+		bits = _mm_movemask_epi8(_mm_sll_epi16(vc, shift));
+		c_o[off] = bits;
+		if (len > 1)
+			c_o[off + 1] = bits >> 8;
+	}
+#else
+	int b;
+
+	for (b = 0 ; b < len ; b++) {
+		uint8_t yb[6] = { 0 }, mb[6] = { 0 }, cb[6] = { 0 };
+		uint8_t kb = 0;
+		int i;
+
+		for (i = b * 8 ; i < b * 8 + 8 ; i++) {
+			uint8_t yv = y[i], mv = m[i], cv = c[i];
+			uint8_t k = 0;
+
+			/* Extract "true black" from ymc data, if enabled */
+			if (k_o && (yv & mv & cv) == 0x3f) {
+				k = 1;
+				yv = mv = cv = 0;
+			}
+			kb = (kb << 1) | k;
+			for (j = 0 ; j < 6 ; j++) {
+				yb[j] = (yb[j] << 1) | ((yv >> j) & 1);
+				mb[j] = (mb[j] << 1) | ((mv >> j) & 1);
+				cb[j] = (cb[j] << 1) | ((cv >> j) & 1);
+			}
+		}
+
+		for (j = 0 ; j < 6 ; j++) {
+			y_o[j * MAGICARD_PLANE_STRIDE + b] = yb[j];
+			m_o[j * MAGICARD_PLANE_STRIDE + b] = mb[j];
+			c_o[j * MAGICARD_PLANE_STRIDE + b] = cb[j];
+		}
+		if (k_o)
+			k_o[b] = kb;
+	}
+#endif
+}
+
 static void downscale_and_extract(int gamma, uint32_t pixels,
 				  uint8_t *y_i, uint8_t *m_i, uint8_t *c_i,
 				  uint8_t *y_o, uint8_t *m_o, uint8_t *c_o, uint8_t *k_o)
 {
+	uint8_t lut[256];
+	uint8_t y[16], m[16], c[16];
 	uint32_t i;
+	uint32_t row = 0;
+	uint32_t b_offset = 0;
+
+	/* Downscale color planes from 8bpp -> 6bpp; */
+	if (gamma) {
+		if (gamma > 2)
+			gamma = 2;
+		memcpy(lut, gammas[gamma - 1], sizeof(lut));
+	} else {
+		for (i = 0 ; i < sizeof(lut) ; i++)
+			lut[i] = i >> 2;
+	}
 
-	for (i = 0 ; i < pixels; i++)
-	{
-		uint8_t y, m, c;
-		uint8_t k = 0;
+	/* Rows are a multiple of 16 pixels, so groups never span rows */
+	for (i = 0 ; i < pixels ; i += 16) {
+		uint32_t n = pixels - i;
 		uint32_t j;
-		uint32_t row;
-		uint32_t col;
-		uint32_t b_offset;
-		uint8_t b_shift;
-
-		/* Downscale color planes from 8bpp -> 6bpp; */
-		if (gamma) {
-			if (gamma > 2)
-				gamma = 2;
-			gamma--;
-			y = gammas[gamma][*y_i++];
-			m = gammas[gamma][*m_i++];
-			c = gammas[gamma][*c_i++];
-		} else {
-			y = *y_i++ >> 2;
-			m = *m_i++ >> 2;
-			c = *c_i++ >> 2;
+		uint32_t out = row * MAGICARD_ROW_STRIDE + b_offset;
+
+		if (n > 16)
+			n = 16;
+		for (j = 0 ; j < n ; j++) {
+			y[j] = lut[y_i[i + j]];
+			m[j] = lut[m_i[i + j]];
+			c[j] = lut[c_i[i + j]];
 		}
+		for ( ; j < 16 ; j++)
+			y[j] = m[j] = c[j] = 0;
 
-		/* Extract "true black" from ymc data, if enabled */
-		if (k_o && y == 0x3f && m == 0x3f && c == 0x3f) {
-			k = 1;
-			y = m = c = 0;
-		}
-
-		/* Compute row number and offsets */
-		row = i / 672;
-		col = i - (row * 672);
-		b_offset = col / 8;
-		b_shift = 7 - (col - (b_offset * 8));
+		magicard_pack16(y, m, c, y_o + out, m_o + out, c_o + out,
+				k_o ? k_o + row * MAGICARD_PLANE_STRIDE + b_offset : NULL,
+				(n + 7) / 8);
 
-		/* Now, for each row, break it down into sub-chunks */
-		for (j = 0 ; j < 6 ; j++) {
-			if (b_shift == 7) {
-				y_o[row * 504 + j * 84 + b_offset] = 0;
-				m_o[row * 504 + j * 84 + b_offset] = 0;
-				c_o[row * 504 + j * 84 + b_offset] = 0;
-			}
-			if (y & (1 << j))
-				y_o[row * 504 + j * 84 + b_offset] |= (1 << b_shift);
-			if (m & (1 << j))
-				m_o[row * 504 + j * 84 + b_offset] |= (1 << b_shift);
-			if (c & (1 << j))
-				c_o[row * 504 + j * 84 + b_offset] |= (1 << b_shift);
-		}
-
-		/* And resin black, if enabled */
-		if (k_o) {
-			if (b_shift == 7) {
-				k_o[row * 84 + b_offset] = 0;
-			}
-			if (k)
-				k_o[row * 84 + b_offset] |= (1 << b_shift);
+		b_offset += 2;
+		if (b_offset == MAGICARD_PLANE_STRIDE) {
+			b_offset = 0;
+			row++;
 		}
 	}
 }
@@ -183,8 +183,10 @@ int mitsu_apply3dlut_packed(struct mitsu_lib *lib, const char *lutfname, uint8_t
 	}
 
 	if (lib->lut) {
+		double start = dyesub_bench_now();
 		DEBUG("Running print data through 3D LUT\n");
 		lib->DoColorConv(lib->lut, databuf, cols, rows, stride, rgb_bgr);
+		dyesub_bench_add(BENCH_IMAGE, start);
 	}
 #endif
 	return CUPS_BACKEND_OK;
@@ -222,8 +224,10 @@ int mitsu_apply3dlut_plane(struct mitsu_lib *lib, const char *lutfname,
 	}
 
 	if (lib->lut) {
+		double start = dyesub_bench_now();
 		DEBUG("Running print data through 3D LUT\n");
 		lib->DoColorConvPlane(lib->lut, data_r, data_g, data_b, cols * rows);
+		dyesub_bench_add(BENCH_IMAGE, start);
 	}
 #endif
 	return CUPS_BACKEND_OK;
@@ -1787,6 +1787,7 @@ static int mitsu70x_main_loop(void *vctx, const void *vjob, int wait_for_return)
 
 	struct BandImage input;
 	uint8_t rew[2] = { 1, 1 }; /* 1 for rewind ok (default!) */
+	double bench_start;
 
 	/* Load in the CPC file, if needed */
 	if (job->cpcfname && job->cpcfname != ctx->last_cpcfname) {
@@ -1838,11 +1839,13 @@ static int mitsu70x_main_loop(void *vctx, const void *vjob, int wait_for_return)
 	ctx->output.bytes_per_row = job->cols * 3 * 2;
 
 	DEBUG("Running print data through processing library\n");
+	bench_start = dyesub_bench_now();
 	if (ctx->lib.DoImageEffect(ctx->lib.cpcdata, ctx->lib.ecpcdata,
 				   &input, &ctx->output, job->sharpen, job->reverse, rew)) {
 		ERROR("Image Processing failed, aborting!\n");
 		return CUPS_BACKEND_CANCEL;
 	}
+	dyesub_bench_add(BENCH_IMAGE, bench_start);
 
 	/* Twiddle rewind stuff if needed */
 	if (ctx->conn->type != P_MITSU_D70X) {
@@ -2609,6 +2612,132 @@ static int mitsu70x_query_stats(void *vctx, struct printerstats *stats)
 	return CUPS_BACKEND_OK;
 }
 
+static int mitsu70x_query_state(void *vctx)
+{
+	struct mitsu70x_ctx *ctx = vctx;
+	struct mitsu70x_jobstatus jobstatus;
+	int state = PRINTER_STATE_ERROR;
+
+	/* Query job status for jobid 0 (global) */
+	if (mitsu70x_get_jobstatus(ctx, &jobstatus, 0x0000))
+		return PRINTER_STATE_ERROR;
+
+	/* Any deck that can take a job right away will do */
+	if (!jobstatus.error_status[0]) {
+		if (jobstatus.temperature != TEMPERATURE_COOLING &&
+		    jobstatus.mecha_status[0] == MECHA_STATUS_IDLE)
+			return PRINTER_STATE_IDLE;
+		state = PRINTER_STATE_BUSY;
+	}
+	if (ctx->num_decks == 2 && !jobstatus.error_status_up[0]) {
+		if (jobstatus.temperature_up != TEMPERATURE_COOLING &&
+		    jobstatus.mecha_status_up[0] == MECHA_STATUS_IDLE)
+			return PRINTER_STATE_IDLE;
+		state = PRINTER_STATE_BUSY;
+	}
+
+	return state;
+}
+
+/* Simulated printer support */
+static int mitsu70x_sim_reply(struct dyesub_sim *sim, const uint8_t *buf, int len)
+{
+	if (len >= (int)sizeof(struct mitsu70x_hdr) &&
+	    buf[0] == 0x1b && buf[1] == 0x5a && buf[2] == 0x54) { /* Print job */
+		const struct mitsu70x_hdr *hdr = (const struct mitsu70x_hdr *) buf;
+		uint32_t planelen, matte = 0;
+
+		/* The image planes (and any matte plane) follow the header */
+		planelen = be16_to_cpu(hdr->rows) * be16_to_cpu(hdr->cols) * 2;
+		planelen = (planelen + 511) / 512 * 512;
+		if (!hdr->laminate && hdr->laminate_mode) {
+			matte = be16_to_cpu(hdr->lamrows) * be16_to_cpu(hdr->lamcols) * 2;
+			matte = (matte + 511) / 512 * 512;
+		}
+		sim->data_remaining = 3 * planelen + matte;
+
+		return sizeof(struct mitsu70x_hdr);
+	}
+
+	if (len < 4 || buf[0] != 0x1b || buf[1] != 0x56)
+		return 0;
+
+	if (buf[2] == 0x32 && len == 4) { /* Printer status */
+		struct mitsu70x_printerstatus_resp resp;
+		const char *ver;
+		int media_code = 0xf;
+		int i;
+
+		if (getenv("MEDIA_CODE"))
+			media_code = atoi(getenv("MEDIA_CODE")) & 0xf;
+
+		switch (sim->type) {
+		case P_MITSU_K60:
+			ver = "316M31";
+			break;
+		case P_KODAK_305:
+			ver = "443B11";
+			break;
+		case P_FUJI_ASK300:
+			ver = "316J21";
+			break;
+		default:
+			ver = "316W11";
+			break;
+		}
+
+		memset(&resp, 0, sizeof(resp));
+		resp.hdr[0] = 0xe4;
+		resp.hdr[1] = 0x56;
+		resp.hdr[2] = 0x32;
+		resp.hdr[3] = 0x30;
+		resp.subtype = 0x5f;
+		memcpy(resp.vers[0].ver, ver, 6);
+		for (i = 0 ; i < 6 ; i++)
+			resp.serno[i] = cpu_to_le16("SIM001"[i]);
+		resp.lower.mecha_status[0] = MECHA_STATUS_IDLE;
+		resp.lower.media_brand = 0xff;
+		resp.lower.media_type = media_code;
+		resp.lower.capacity = cpu_to_be16(230);
+		resp.lower.remain = cpu_to_be16(230 - sim->state);
+
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		return 4;
+	} else if (buf[2] == 0x31 && buf[3] == 0x30 && len == 6) { /* Job status */
+		struct mitsu70x_jobstatus resp;
+
+		memset(&resp, 0, sizeof(resp));
+		resp.hdr[0] = 0xe4;
+		resp.hdr[1] = 0x56;
+		resp.hdr[2] = 0x31;
+		resp.hdr[3] = 0x30;
+		memcpy(&resp.jobid, buf + 4, 2);
+		/* Any specific job we're asked about has already completed */
+		if (resp.jobid)
+			resp.job_status[0] = JOB_STATUS0_END;
+		resp.mecha_status[0] = MECHA_STATUS_IDLE;
+		resp.mecha_status_up[0] = MECHA_STATUS_IDLE;
+
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		return 6;
+	} else if (buf[2] == 0x33 && len == 10) { /* Memory status */
+		struct mitsu70x_memorystatus_resp resp;
+
+		memset(&resp, 0, sizeof(resp));
+		resp.hdr[0] = 0xe4;
+		resp.hdr[1] = 0x56;
+		resp.hdr[2] = 0x33;
+
+		/* Memory is available, so a job follows */
+		sim->state++;
+
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		return 10;
+	}
+
+	return 0;
+}
+
 static const char *mitsu70x_prefixes[] = {
 	"mitsu70x", // Family entry, do not nuke.
 	// backwards compatibility
@@ -2633,8 +2762,10 @@ const struct dyesub_backend mitsu70x_backend = {
 	.query_serno = mitsu70x_query_serno,
 	.query_markers = mitsu70x_query_markers,
 	.query_stats = mitsu70x_query_stats,
+	.query_state = mitsu70x_query_state,
 	.combine_jobs = mitsu70x_combine_jobs,
 	.job_polarity = mitsu70x_job_polarity,
+	.sim_reply = mitsu70x_sim_reply,
 	.devices = {
 		{ 0x06d3, 0x3b30, P_MITSU_D70X, NULL, "mitsubishi-d70dw"},
 		{ 0x06d3, 0x3b30, P_MITSU_D70X, NULL, "mitsubishi-d707dw"}, /* Duplicate */
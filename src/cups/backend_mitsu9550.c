@@ -1045,6 +1045,7 @@ static int mitsu9550_main_loop(void *vctx, const void *vjob, int wait_for_return
 	/* Create band images for input and output */
 	struct BandImage input;
 	struct BandImage output;
+	double bench_start;
 
 	uint8_t *convbuf = malloc(planelen * 3);
 	if (!convbuf) {
@@ -1065,12 +1066,14 @@ static int mitsu9550_main_loop(void *vctx, const void *vjob, int wait_for_return
 	output.imgbuf = convbuf;
 	output.bytes_per_row = job->cols * 3 * sizeof(uint16_t);
 
+	bench_start = dyesub_bench_now();
 	if (!ctx->lib.CP98xx_DoConvert(ctx->m98xxdata, &input, &output, job->hdr2.mode, sharpness, job->hdr2.unkc[8])) {
 		free(convbuf);
 		free(newbuf);
 		ERROR("CP98xx_DoConvert() failed!\n");
 		return CUPS_BACKEND_FAILED;
 	}
+	dyesub_bench_add(BENCH_IMAGE, bench_start);
 
 	/* Clear special extension flags used by our backend */
 	if (job->hdr2.mode == 0x11)
@@ -1215,6 +1215,119 @@ static int shinkos2145_query_stats(void *vctx,  struct printerstats *stats)
 	return CUPS_BACKEND_OK;
 }
 
+static int shinkos2145_query_state(void *vctx)
+{
+	struct shinkos2145_ctx *ctx = vctx;
+	struct sinfonia_cmd_hdr cmd;
+	struct s2145_status_resp sts;
+	int num;
+
+	/* Query Status */
+	cmd.cmd = cpu_to_le16(SINFONIA_CMD_GETSTATUS);
+	cmd.len = cpu_to_le16(0);
+
+	if (sinfonia_docmd(&ctx->dev,
+			   (uint8_t*)&cmd, sizeof(cmd),
+			   (uint8_t*)&sts, sizeof(sts),
+			   &num)) {
+		return PRINTER_STATE_ERROR;
+	}
+
+	if (sts.hdr.status == ERROR_PRINTER)
+		return PRINTER_STATE_ERROR;
+	if (sts.hdr.status == STATUS_READY ||
+	    sts.hdr.status == STATUS_FINISHED)
+		return PRINTER_STATE_IDLE;
+
+	return PRINTER_STATE_BUSY;
+}
+
+/* Simulated printer support */
+static const struct {
+	uint8_t code;
+	uint16_t columns;
+	uint16_t rows;
+} s2145_sim_media[] = {
+	{ CODE_4x6, 1844, 1240 },
+	{ CODE_5x7, 1548, 2140 },
+	{ CODE_6x8, 1844, 2434 },
+	{ CODE_6x9, 1844, 2740 },
+};
+
+static int shinkos2145_sim_reply(struct dyesub_sim *sim, const uint8_t *buf, int len)
+{
+	const struct sinfonia_cmd_hdr *cmd = (const struct sinfonia_cmd_hdr *) buf;
+	int cmdlen;
+
+	if (len < (int)sizeof(*cmd))
+		return 0;
+	cmdlen = sizeof(*cmd) + le16_to_cpu(cmd->len);
+	if (cmdlen > len)
+		return 0;
+
+	switch (le16_to_cpu(cmd->cmd)) {
+	case SINFONIA_CMD_GETSTATUS: {
+		struct s2145_status_resp resp;
+
+		memset(&resp, 0, sizeof(resp));
+		resp.hdr.result = RESULT_SUCCESS;
+		resp.hdr.status = STATUS_READY;
+		resp.hdr.payload_len = cpu_to_le16(sizeof(resp) - sizeof(resp.hdr));
+		resp.count_ribbon_left = cpu_to_le32(600 - sim->state);
+		resp.bank1_status = BANK_STATUS_FREE;
+		resp.bank2_status = BANK_STATUS_FREE;
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		break;
+	}
+	case SINFONIA_CMD_MEDIAINFO: {
+		struct s2145_mediainfo_resp resp;
+		int i;
+
+		memset(&resp, 0, sizeof(resp));
+		resp.hdr.result = RESULT_SUCCESS;
+		resp.hdr.payload_len = cpu_to_le16(sizeof(resp) - sizeof(resp.hdr));
+		resp.count = sizeof(s2145_sim_media) / sizeof(s2145_sim_media[0]);
+		for (i = 0 ; i < resp.count ; i++) {
+			resp.items[i].code = s2145_sim_media[i].code;
+			resp.items[i].columns = cpu_to_le16(s2145_sim_media[i].columns);
+			resp.items[i].rows = cpu_to_le16(s2145_sim_media[i].rows);
+			resp.items[i].method = PRINT_METHOD_STD;
+		}
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		break;
+	}
+	case SINFONIA_CMD_PRINTJOB: {
+		const struct sinfonia_printcmd10_hdr *print = (const struct sinfonia_printcmd10_hdr *) buf;
+		struct sinfonia_status_hdr resp;
+
+		if (cmdlen < (int)sizeof(*print))
+			return 0;
+
+		/* RGB-packed image data follows */
+		sim->data_remaining = le16_to_cpu(print->columns) * le16_to_cpu(print->rows) * 3;
+		sim->state += le16_to_cpu(print->copies);
+
+		memset(&resp, 0, sizeof(resp));
+		resp.result = RESULT_SUCCESS;
+		resp.status = STATUS_READY;
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		break;
+	}
+	default: {
+		/* Everything else just gets acknowledged */
+		struct sinfonia_status_hdr resp;
+
+		memset(&resp, 0, sizeof(resp));
+		resp.result = RESULT_SUCCESS;
+		resp.status = STATUS_READY;
+		dyesub_sim_respond(sim, &resp, sizeof(resp));
+		break;
+	}
+	}
+
+	return cmdlen;
+}
+
 static const char *shinkos2145_prefixes[] = {
 	"shinkos2145", /* Family Name */
 	NULL
@@ -1234,6 +1347,8 @@ const struct dyesub_backend shinkos2145_backend = {
 	.query_serno = shinkos2145_query_serno,
 	.query_markers = shinkos2145_query_markers,
 	.query_stats = shinkos2145_query_stats,
+	.query_state = shinkos2145_query_state,
+	.sim_reply = shinkos2145_sim_reply,
 	.devices = {
 		{ 0x10ce, 0x000e, P_SHINKO_S2145, NULL, "shinko-chcs2145"},
 		{ 0x10ce, 0x000e, P_SHINKO_S2145, NULL, "sinfonia-chcs2145"}, /* Duplicate */
@@ -857,10 +857,66 @@ static int shinkos6145_dump_eeprom(struct shinkos6145_ctx *ctx, char *fname)
 	return ret;
 }
 
+/* The correction data is derived from the printer's calibration, so key
+   any cached copy on the serial number, firmware, and EEPROM contents. */
+static int shinkos6145_corr_cachekey(struct shinkos6145_ctx *ctx, uint8_t options,
+				     char *key, int keylen)
+{
+	struct sinfonia_fwinfo_cmd fcmd;
+	struct sinfonia_fwinfo_resp resp;
+	int num = 0;
+
+	if (!cache_path || !ctx->eeprom || !ctx->eepromlen)
+		return -1;
+
+	if (!ctx->serial[0] &&
+	    sinfonia_query_serno(ctx->dev.conn, ctx->serial, sizeof(ctx->serial)))
+		return -1;
+
+	fcmd.hdr.cmd = cpu_to_le16(SINFONIA_CMD_FWINFO);
+	fcmd.hdr.len = cpu_to_le16(1);
+	fcmd.target = FWINFO_TARGET_MAIN_APP;
+
+	if (sinfonia_docmd(&ctx->dev,
+			   (uint8_t*)&fcmd, sizeof(fcmd),
+			   (uint8_t*)&resp, sizeof(resp),
+			   &num))
+		return -1;
+
+	snprintf(key, keylen, "s6145-corr-%d-%s-%d.%d-%04x-%02x-%08x",
+		 ctx->dev.conn->type, ctx->serial,
+		 resp.major, resp.minor, le16_to_cpu(resp.checksum),
+		 options, dyesub_crc32(ctx->eeprom, ctx->eepromlen));
+
+	return 0;
+}
+
+static int shinkos6145_load_cached_corr(struct shinkos6145_ctx *ctx, const char *key,
+					size_t extra)
+{
+	size_t len = 0;
+
+	ctx->corrdata = dyesub_cache_load(key, &len, extra);
+	if (!ctx->corrdata)
+		return 0;
+	if (len > 0xffff) {
+		free(ctx->corrdata);
+		ctx->corrdata = NULL;
+		return 0;
+	}
+
+	ctx->corrdatalen = len;
+	INFO("Using cached image correction data (%u bytes)\n", ctx->corrdatalen);
+
+	return 1;
+}
+
 static int shinkos6145_get_imagecorr(struct shinkos6145_ctx *ctx)
 {
 	struct sinfonia_cmd_hdr cmd;
 	struct s6145_imagecorr_resp resp;
+	char key[96];
+	int cached;
 
 	uint16_t total = 0;
 	int ret, num;
@@ -872,6 +928,10 @@ static int shinkos6145_get_imagecorr(struct shinkos6145_ctx *ctx)
 		ctx->corrdata = NULL;
 	}
 
+	cached = !shinkos6145_corr_cachekey(ctx, 0, key, sizeof(key));
+	if (cached && shinkos6145_load_cached_corr(ctx, key, S6145_CORRDATA_EXTRA_LEN))
+		return CUPS_BACKEND_OK;
+
 	if ((ret = sinfonia_docmd(&ctx->dev,
 				  (uint8_t*)&cmd, sizeof(cmd),
 				  (uint8_t*)&resp, sizeof(resp),
@@ -909,6 +969,9 @@ static int shinkos6145_get_imagecorr(struct shinkos6145_ctx *ctx)
 
 	}
 
+	if (cached)
+		dyesub_cache_store(key, ctx->corrdata, ctx->corrdatalen);
+
 done:
 	return ret;
 }
@@ -917,6 +980,8 @@ static int shinkos2245_get_imagecorr(struct shinkos6145_ctx *ctx, uint8_t option
 {
 	struct s2245_imagecorr_req cmd;
 	struct s2245_imagecorr_resp resp;
+	char key[96];
+	int cached;
 
 	uint16_t total = 0;
 	int ret, num;
@@ -931,6 +996,10 @@ static int shinkos2245_get_imagecorr(struct shinkos6145_ctx *ctx, uint8_t option
 		ctx->corrdata = NULL;
 	}
 
+	cached = !shinkos6145_corr_cachekey(ctx, options, key, sizeof(key));
+	if (cached && shinkos6145_load_cached_corr(ctx, key, 0))
+		return CUPS_BACKEND_OK;
+
 	if ((ret = sinfonia_docmd(&ctx->dev,
 				  (uint8_t*)&cmd, sizeof(cmd),
 				  (uint8_t*)&resp, sizeof(resp),
@@ -967,6 +1036,9 @@ static int shinkos2245_get_imagecorr(struct shinkos6145_ctx *ctx, uint8_t option
 
 	}
 
+	if (cached)
+		dyesub_cache_store(key, ctx->corrdata, ctx->corrdatalen);
+
 done:
 	return ret;
 }
@@ -1711,12 +1783,14 @@ top:
 			memcpy((uint8_t*)ctx->corrdata + S6145_CORRDATA_HEIGHT_OFFSET, &tmp, sizeof(tmp));
 
 			/* Perform the actual library transform */
+			double bench_start = dyesub_bench_now();
 			if (ctx->ImageAvrCalc(job->databuf, job->jp.columns, job->jp.rows, ctx->image_avg)) {
 				free(databuf2);
 				ERROR("Library returned error!\n");
 				return CUPS_BACKEND_FAILED;
 			}
 			ctx->ImageProcessing(job->databuf, databuf2, ctx->corrdata);
+			dyesub_bench_add(BENCH_IMAGE, bench_start);
 
 			free(job->databuf);
 			job->databuf = (uint8_t*) databuf2;
@@ -0,0 +1,236 @@
+/*
+ *   Simulated printer and benchmark support for the CUPS backends
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>.
+ *
+ *   SPDX-License-Identifier: GPL-2.0+
+ *
+ */
+
+/*
+   The simulator stands in for the USB endpoints of a real printer.  The
+   backend talks to it through the normal send_data()/read_data() calls;
+   each outbound transfer is handed to the backend's sim_reply hook, which
+   decodes the command and queues up whatever the printer would answer.
+   Anything the hook does not recognize (or flags as payload via
+   data_remaining) is silently consumed, just like image data.
+
+   Transfers are throttled according to SIM_LATENCY (microseconds per
+   transfer) and SIM_BANDWIDTH (KiB/s) so the numbers reported by the
+   benchmark resemble those of real hardware.
+*/
+
+#include "backend_common.h"
+
+#include <errno.h>
+
+/* Benchmark accounting */
+int dyesub_benchmark = 0;
+
+static double bench_total[BENCH_MAX];
+static double page_min, page_max;
+static int page_count;
+
+double dyesub_bench_now(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+void dyesub_bench_add(int which, double start)
+{
+	double elapsed;
+
+	if (!dyesub_benchmark || which < 0 || which >= BENCH_MAX)
+		return;
+
+	elapsed = dyesub_bench_now() - start;
+	bench_total[which] += elapsed;
+
+	if (which == BENCH_PAGE) {
+		if (!page_count || elapsed < page_min)
+			page_min = elapsed;
+		if (!page_count || elapsed > page_max)
+			page_max = elapsed;
+		page_count++;
+	}
+}
+
+double dyesub_bench_total(int which)
+{
+	if (which < 0 || which >= BENCH_MAX)
+		return 0;
+
+	return bench_total[which];
+}
+
+void dyesub_bench_report(const struct dyesub_backend *backend, int runs)
+{
+	fprintf(stdout, "Benchmark: %s backend, %d run(s)\n", backend->name, runs);
+	fprintf(stdout, "  Parse time:            %10.3f ms\n",
+		bench_total[BENCH_PARSE] * 1000);
+	fprintf(stdout, "  Image processing time: %10.3f ms\n",
+		bench_total[BENCH_IMAGE] * 1000);
+	fprintf(stdout, "  Transfer time:         %10.3f ms\n",
+		bench_total[BENCH_XFER] * 1000);
+	if (page_count) {
+		fprintf(stdout, "  Pages:                 %10d\n", page_count);
+		fprintf(stdout, "  Page latency (min):    %10.3f ms\n", page_min * 1000);
+		fprintf(stdout, "  Page latency (avg):    %10.3f ms\n",
+			bench_total[BENCH_PAGE] * 1000 / page_count);
+		fprintf(stdout, "  Page latency (max):    %10.3f ms\n", page_max * 1000);
+	} else {
+		fprintf(stdout, "  Pages:                 %10d\n", 0);
+	}
+}
+
+/* Simulated device */
+struct dyesub_sim *dyesub_sim_create(const struct dyesub_backend *backend, int type)
+{
+	struct dyesub_sim *sim;
+
+	if (!backend->sim_reply) {
+		ERROR("Backend '%s' does not support simulation\n", backend->name);
+		return NULL;
+	}
+
+	sim = malloc(sizeof(*sim));
+	if (!sim) {
+		ERROR("Memory allocation failure!\n");
+		return NULL;
+	}
+	memset(sim, 0, sizeof(*sim));
+
+	sim->type = type;
+	sim->reply = backend->sim_reply;
+
+	if (getenv("SIM_LATENCY"))
+		sim->latency = atol(getenv("SIM_LATENCY"));
+	if (getenv("SIM_BANDWIDTH"))
+		sim->bandwidth = atol(getenv("SIM_BANDWIDTH")) * 1024;
+
+	return sim;
+}
+
+void dyesub_sim_destroy(struct dyesub_sim *sim)
+{
+	if (!sim)
+		return;
+
+	if (dyesub_debug)
+		DEBUG("Simulator: %llu bytes sent, %llu bytes received\n",
+		      (unsigned long long) sim->bytes_out,
+		      (unsigned long long) sim->bytes_in);
+	free(sim);
+}
+
+static void sim_delay(const struct dyesub_sim *sim, int len)
+{
+	long usecs = sim->latency;
+
+	if (sim->bandwidth > 0)
+		usecs += (long)((double)len * 1000000 / sim->bandwidth);
+
+	if (usecs <= 0)
+		return;
+
+#ifndef _WIN32
+	{
+		struct timespec ts;
+		ts.tv_sec = usecs / 1000000;
+		ts.tv_nsec = (usecs % 1000000) * 1000;
+		while (nanosleep(&ts, &ts) && errno == EINTR)
+			;
+	}
+#else
+	usleep(usecs);
+#endif
+}
+
+int dyesub_sim_respond(struct dyesub_sim *sim, const void *buf, int len)
+{
+	/* Discard anything that was never read back */
+	if (sim->resp_pos >= sim->resp_len)
+		sim->resp_len = sim->resp_pos = 0;
+
+	if (sim->resp_len + len > SIM_RESP_MAX) {
+		ERROR("Simulator response overflow (%d bytes)\n", len);
+		return -1;
+	}
+
+	memcpy(sim->resp + sim->resp_len, buf, len);
+	sim->resp_len += len;
+
+	return CUPS_BACKEND_OK;
+}
+
+int dyesub_sim_write(struct dyesub_sim *sim, const uint8_t *buf, int len, int *num)
+{
+	int remain = len;
+
+	sim_delay(sim, len);
+
+	while (remain > 0) {
+		int used;
+
+		/* Swallow any outstanding payload first */
+		if (sim->data_remaining) {
+			used = remain;
+			if ((uint32_t)used > sim->data_remaining)
+				used = sim->data_remaining;
+			sim->data_remaining -= used;
+		} else {
+			used = sim->reply(sim, buf, remain);
+			if (used <= 0)
+				used = remain; /* Unrecognized; treat as data */
+		}
+
+		buf += used;
+		remain -= used;
+	}
+
+	sim->bytes_out += len;
+	*num = len;
+
+	return 0;
+}
+
+int dyesub_sim_read(struct dyesub_sim *sim, uint8_t *buf, int buflen, int *num)
+{
+	int len = sim->resp_len - sim->resp_pos;
+
+	*num = 0;
+
+	/* Nothing queued up; a real printer would just time out */
+	if (len <= 0)
+		return LIBUSB_ERROR_TIMEOUT;
+
+	if (len > buflen)
+		len = buflen;
+
+	sim_delay(sim, len);
+
+	memcpy(buf, sim->resp + sim->resp_pos, len);
+	sim->resp_pos += len;
+	sim->bytes_in += len;
+	*num = len;
+
+	return 0;
+}
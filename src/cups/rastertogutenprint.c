@@ -55,6 +55,9 @@
 #ifdef HAVE_LIMITS_H
 #include <limits.h>
 #endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "i18n.h"
 #include <gutenprint/xml.h>
 
@@ -76,6 +79,8 @@
 #define CUPS_READ_HEADER cupsRasterReadHeader
 #endif
 
+typedef struct raster_reader raster_reader_t;
+
 typedef struct
 {
   cups_raster_t		*ras;		/* Raster stream to read from */
@@ -106,8 +111,47 @@ typedef struct
   int			last_percent;
   int			shrink_to_fit;
   CUPS_HEADER_T		header;		/* Page header from file */
+  raster_reader_t	*reader;	/* Rows read ahead for this page */
 } cups_image_t;
 
+/*
+ * Rows are read ahead of the driver into a ring of whole raster lines,
+ * by a separate thread where we have one, so that decompressing the
+ * incoming raster overlaps with color conversion, dithering and
+ * weaving.  Margins are trimmed by handing out an offset into the line,
+ * and 1-bit rows are expanded by the reader.  STP_RASTER_READAHEAD sets
+ * the number of rows buffered; 0 reads each row when it is asked for.
+ */
+
+#define DEFAULT_READAHEAD_ROWS 16
+
+struct raster_reader
+{
+  cups_raster_t		*ras;
+  unsigned char		**slots;	/* Raster line, then expanded row */
+  int			nslots;
+  int			line_size;	/* cupsBytesPerLine */
+  int			height;		/* Rows on the page */
+  int			left_margin;	/* Bytes trimmed on the left */
+  int			expand_width;	/* Pixels to expand for 1-bit data */
+  int			out_offset;	/* Where the row starts in a slot */
+  int			rows_taken;
+  int			eof;
+#ifdef HAVE_PTHREAD
+  int			threaded;
+  pthread_t		thread;
+  pthread_mutex_t	lock;
+  pthread_cond_t	filled;
+  pthread_cond_t	emptied;
+  int			head;		/* Oldest filled slot */
+  int			count;		/* Filled slots */
+  int			holding;	/* Head slot is lent to the driver */
+  int			rows_read;
+  int			done;
+  int			stop;
+#endif
+};
+
 static void	cups_writefunc(void *file, const char *buf, size_t bytes);
 static void	cups_errfunc(void *file, const char *buf, size_t bytes);
 static void	cups_dbgfunc(void *file, const char *buf, size_t bytes);
@@ -633,24 +677,218 @@ initialize_page(cups_image_t *cups, const stp_vars_t *default_settings,
   return v;
 }
 
-static void
-purge_excess_data(cups_image_t *cups)
+/*
+ * 'read_raster_row()' - Read one raster line, expanding 1-bit data.
+ */
+
+static int
+read_raster_row(raster_reader_t *r, unsigned char *slot)
+{
+  int i;
+  if (cupsRasterReadPixels(r->ras, slot, r->line_size) == 0)
+    return 0;
+  if (r->expand_width)
+    {
+      const unsigned char *in = slot + r->left_margin;
+      unsigned char *out = slot + r->line_size;
+      for (i = 0; i < r->expand_width; i++)
+	out[i] = ((in[i / 8] >> (7 - i % 8)) & 0x1) ? 255 : 0;
+    }
+  return 1;
+}
+
+#ifdef HAVE_PTHREAD
+static int
+readahead_rows(void)
+{
+  const char *readahead = getenv("STP_RASTER_READAHEAD");
+  return readahead ? atoi(readahead) : DEFAULT_READAHEAD_ROWS;
+}
+
+static void *
+raster_reader_thread(void *arg)
+{
+  raster_reader_t *r = (raster_reader_t *) arg;
+  pthread_mutex_lock(&r->lock);
+  while (!r->stop && r->rows_read < r->height)
+    {
+      unsigned char *slot;
+      int status;
+      while (!r->stop && r->count == r->nslots)
+	pthread_cond_wait(&r->emptied, &r->lock);
+      if (r->stop)
+	break;
+      slot = r->slots[(r->head + r->count) % r->nslots];
+      pthread_mutex_unlock(&r->lock);
+      status = read_raster_row(r, slot);
+      pthread_mutex_lock(&r->lock);
+      if (!status)
+	break;
+      r->rows_read++;
+      r->count++;
+      pthread_cond_signal(&r->filled);
+    }
+  r->done = 1;
+  pthread_cond_signal(&r->filled);
+  pthread_mutex_unlock(&r->lock);
+  return NULL;
+}
+#endif
+
+/*
+ * 'raster_reader_start()' - Start reading rows of the current page.
+ */
+
+static raster_reader_t *
+raster_reader_start(cups_image_t *cups)
+{
+  raster_reader_t *r = stp_zalloc(sizeof(raster_reader_t));
+  int slot_size;
+
+  r->ras = cups->ras;
+  r->line_size = cups->header.cupsBytesPerLine;
+  r->height = cups->header.cupsHeight;
+  r->left_margin =
+    ((cups->left_trim * cups->header.cupsBitsPerPixel) + CHAR_BIT - 1) /
+    CHAR_BIT;
+  slot_size = r->line_size;
+  if (cups->header.cupsBitsPerPixel == 1)
+    {
+      r->expand_width = cups->adjusted_width;
+      r->out_offset = r->line_size;
+      slot_size += r->expand_width;
+    }
+  else
+    r->out_offset = r->left_margin;
+  if (! suppress_messages && ! suppress_verbose_messages)
+    fprintf(stderr, "DEBUG2: Gutenprint: Trimming left %d (%d), right %d (%d)\n",
+	    r->left_margin, cups->left_trim,
+	    r->line_size - r->left_margin -
+	    (((cups->adjusted_width * cups->header.cupsBitsPerPixel) +
+	      CHAR_BIT - 1) / CHAR_BIT), cups->right_trim);
+
+#ifdef HAVE_PTHREAD
+  r->nslots = readahead_rows();
+  if (r->nslots > 0 && r->height > 1)
+    {
+      int i;
+      r->slots = stp_zalloc(sizeof(unsigned char *) * r->nslots);
+      for (i = 0; i < r->nslots; i++)
+	r->slots[i] = stp_malloc(slot_size);
+      pthread_mutex_init(&r->lock, NULL);
+      pthread_cond_init(&r->filled, NULL);
+      pthread_cond_init(&r->emptied, NULL);
+      if (pthread_create(&r->thread, NULL, raster_reader_thread, r) == 0)
+	{
+	  r->threaded = 1;
+	  return r;
+	}
+      pthread_cond_destroy(&r->filled);
+      pthread_cond_destroy(&r->emptied);
+      pthread_mutex_destroy(&r->lock);
+      for (i = 1; i < r->nslots; i++)
+	stp_free(r->slots[i]);
+    }
+  else
+#endif
+    {
+      r->slots = stp_zalloc(sizeof(unsigned char *));
+      r->slots[0] = stp_malloc(slot_size);
+    }
+  r->nslots = 1;
+  return r;
+}
+
+/*
+ * 'raster_reader_next()' - Get the next raster row, or NULL at the end
+ *                          of the page.  The row stays valid until the
+ *                          next call.
+ */
+
+static const unsigned char *
+raster_reader_next(raster_reader_t *r)
 {
-  char *buffer = stp_malloc(cups->header.cupsBytesPerLine);
-  if (buffer)
+  const unsigned char *slot = NULL;
+  if (r->rows_taken >= r->height)
+    return NULL;
+#ifdef HAVE_PTHREAD
+  if (r->threaded)
     {
-      if (! suppress_messages && ! suppress_verbose_messages )
-	fprintf(stderr, "DEBUG2: Gutenprint: Purging %d row%s\n",
-		cups->header.cupsHeight - cups->row,
-		((cups->header.cupsHeight - cups->row) == 1 ? "" : "s"));
-      while (cups->row < cups->header.cupsHeight)
+      pthread_mutex_lock(&r->lock);
+      if (r->holding)
 	{
-	  cupsRasterReadPixels(cups->ras, (unsigned char *)buffer,
-			       cups->header.cupsBytesPerLine);
-	  cups->row ++;
+	  r->head = (r->head + 1) % r->nslots;
+	  r->count--;
+	  r->holding = 0;
+	  pthread_cond_signal(&r->emptied);
 	}
+      while (r->count == 0 && !r->done)
+	pthread_cond_wait(&r->filled, &r->lock);
+      if (r->count > 0)
+	{
+	  slot = r->slots[r->head];
+	  r->holding = 1;
+	}
+      pthread_mutex_unlock(&r->lock);
+    }
+  else
+#endif
+  if (!r->eof)
+    {
+      if (read_raster_row(r, r->slots[0]))
+	slot = r->slots[0];
+      else
+	r->eof = 1;
+    }
+  if (slot)
+    {
+      r->rows_taken++;
+      return slot + r->out_offset;
+    }
+  return NULL;
+}
+
+/*
+ * 'raster_reader_finish()' - Stop reading the page and free the reader.
+ *                            Unless we're giving up on the job, the
+ *                            rest of the page has already been read.
+ */
+
+static void
+raster_reader_finish(raster_reader_t *r, int abandon)
+{
+  int i;
+  if (!r)
+    return;
+#ifdef HAVE_PTHREAD
+  if (r->threaded)
+    {
+      pthread_mutex_lock(&r->lock);
+      r->stop = abandon;
+      pthread_cond_signal(&r->emptied);
+      pthread_mutex_unlock(&r->lock);
+      pthread_join(r->thread, NULL);
+      pthread_cond_destroy(&r->filled);
+      pthread_cond_destroy(&r->emptied);
+      pthread_mutex_destroy(&r->lock);
     }
-  stp_free(buffer);
+#endif
+  for (i = 0; i < r->nslots; i++)
+    stp_free(r->slots[i]);
+  stp_free(r->slots);
+  stp_free(r);
+}
+
+static void
+purge_excess_data(cups_image_t *cups)
+{
+  if (! suppress_messages && ! suppress_verbose_messages )
+    fprintf(stderr, "DEBUG2: Gutenprint: Purging %d row%s\n",
+	    cups->header.cupsHeight - cups->row,
+	    ((cups->header.cupsHeight - cups->row) == 1 ? "" : "s"));
+  while (cups->row < cups->header.cupsHeight &&
+	 raster_reader_next(cups->reader))
+    cups->row ++;
 }
 
 static void
@@ -1099,6 +1337,7 @@ main(int  argc,				/* I - Number of command-line arguments */
   struct timeval	t1, t2;
   char			*page_size_name = NULL;
   int			aborted = 0;
+  CUPS_HEADER_T		last_header;	/* Header of the last page set up */
 #ifdef ENABLE_CUPS_LOAD_SAVE_OPTIONS
   stp_vars_t		*loaded_settings = NULL;
 #endif /* ENABLE_CUPS_LOAD_SAVE_OPTIONS */
@@ -1329,15 +1568,14 @@ main(int  argc,				/* I - Number of command-line arguments */
   while (CUPS_READ_HEADER(cups.ras, &cups.header))
     {
       /*
-       * We don't know how many pages we're going to print, and
-       * we need to call stp_end_job at the completion of the job.
-       * Therefore, we need to keep v in scope after the termination
-       * of the loop to permit calling stp_end_job then.  Therefore,
-       * we have to free the previous page's stp_vars_t at the start
-       * of the loop.
+       * Pages of a job usually share all of their settings.  If this
+       * page's header is identical to the last one, keep the last
+       * page's stp_vars_t (which has already been verified) and only
+       * move the page number along, rather than rebuilding and
+       * reverifying the settings from scratch.
        */
-      if (v)
-	stp_vars_destroy(v);
+      int reuse_settings =
+	v && memcmp(&last_header, &cups.header, sizeof(CUPS_HEADER_T)) == 0;
 
       /*
        * Setup printer driver variables...
@@ -1347,33 +1585,57 @@ main(int  argc,				/* I - Number of command-line arguments */
 	  fprintf(stderr, "DEBUG: Gutenprint: ================ Printing page %d      ================\n", cups.page + 1);
 	  fprintf(stderr, "PAGE: %d %d\n", cups.page + 1, cups.header.NumCopies);
 	}
-      v = initialize_page(&cups, default_settings, page_size_name);
-#ifdef ENABLE_CUPS_LOAD_SAVE_OPTIONS
-      if (loaded_settings)
-	stp_copy_vars_from(v, loaded_settings);
-      if (save_file_name)
+      if (reuse_settings)
 	{
-	  save_options(save_file_name, v);
-	  save_file_name = NULL;
+	  int verified = stp_get_verified(v);
+	  if (! suppress_messages)
+	    fprintf(stderr, "DEBUG: Gutenprint: Reusing settings from page %d\n",
+		    cups.page);
+	  stp_set_int_parameter(v, "PageNumber", cups.page);
+	  stp_set_verified(v, verified);
 	}
-#endif /* ENABLE_CUPS_LOAD_SAVE_OPTIONS */
-      if (! suppress_messages)
+      else
 	{
-	  fprintf(stderr, "DEBUG: Gutenprint: Interim page settings:\n");
-	  stp_vars_print_error(v, "DEBUG");
-	}
-
-      stp_merge_printvars(v, stp_printer_get_defaults(printer));
+	  /*
+	   * We don't know how many pages we're going to print, and
+	   * we need to call stp_end_job at the completion of the job.
+	   * Therefore, we need to keep v in scope after the termination
+	   * of the loop to permit calling stp_end_job then.  Therefore,
+	   * we have to free the previous page's stp_vars_t here rather
+	   * than at the end of the loop.
+	   */
+	  if (v)
+	    stp_vars_destroy(v);
+	  v = initialize_page(&cups, default_settings, page_size_name);
+#ifdef ENABLE_CUPS_LOAD_SAVE_OPTIONS
+	  if (loaded_settings)
+	    stp_copy_vars_from(v, loaded_settings);
+	  if (save_file_name)
+	    {
+	      save_options(save_file_name, v);
+	      save_file_name = NULL;
+	    }
+#endif /* ENABLE_CUPS_LOAD_SAVE_OPTIONS */
+	  if (! suppress_messages)
+	    {
+	      fprintf(stderr, "DEBUG: Gutenprint: Interim page settings:\n");
+	      stp_vars_print_error(v, "DEBUG");
+	    }
 
-      /* Pass along Collation settings */
-      stp_set_boolean_parameter(v, "Collate", cups.header.Collate);
-      stp_set_boolean_parameter_active(v, "Collate", STP_PARAMETER_ACTIVE);
-      /* Pass along Copy settings */
-      stp_set_int_parameter(v, "NumCopies", cups.header.NumCopies);
-      stp_set_int_parameter_active(v, "NumCopies", STP_PARAMETER_ACTIVE);
-      /* Pass along the page number */
-      stp_set_int_parameter(v, "PageNumber", cups.page);
+	  stp_merge_printvars(v, stp_printer_get_defaults(printer));
+
+	  /* Pass along Collation settings */
+	  stp_set_boolean_parameter(v, "Collate", cups.header.Collate);
+	  stp_set_boolean_parameter_active(v, "Collate", STP_PARAMETER_ACTIVE);
+	  /* Pass along Copy settings */
+	  stp_set_int_parameter(v, "NumCopies", cups.header.NumCopies);
+	  stp_set_int_parameter_active(v, "NumCopies", STP_PARAMETER_ACTIVE);
+	  /* Pass along the page number */
+	  stp_set_int_parameter(v, "PageNumber", cups.page);
+	  last_header = cups.header;
+	}
       cups.row = 0;
+      cups.reader = raster_reader_start(&cups);
       if (! suppress_messages)
 	print_debug_block(v, &cups);
       print_messages_as_errors = 1;
@@ -1384,7 +1646,12 @@ main(int  argc,				/* I - Number of command-line arguments */
 	  initialized_job = 1;
 	}
 
-      if (!stp_print(v, &theImage))
+      /*
+       * Verify the settings here rather than leaving it to the driver,
+       * which only verifies a private copy; that way a page that reuses
+       * these settings doesn't have to verify them again.
+       */
+      if (!stp_verify(v) || !stp_print(v, &theImage))
 	{
 	  if (Image_status != STP_IMAGE_STATUS_ABORT)
 	    {
@@ -1394,6 +1661,7 @@ main(int  argc,				/* I - Number of command-line arguments */
 	      fprintf(stderr, "DEBUG: Gutenprint: If this is not the cause, set LogLevel to debug to identify the problem.\n");
 	    }
 	    aborted = 1;
+	  raster_reader_finish(cups.reader, 1);
 	  break;
 	}
       print_messages_as_errors = 0;
@@ -1405,6 +1673,7 @@ main(int  argc,				/* I - Number of command-line arguments */
        */
       if (cups.row < cups.header.cupsHeight)
 	purge_excess_data(&cups);
+      raster_reader_finish(cups.reader, 0);
       if (! suppress_messages)
 	fprintf(stderr, "DEBUG: Gutenprint: ================ Done printing page %d ================\n", cups.page + 1);
       cups.page ++;
@@ -1535,21 +1804,6 @@ Image_get_appname(stp_image_t *image)		/* I - Image */
  * 'Image_get_row()' - Get one row of the image.
  */
 
-static void
-throwaway_data(int amount, cups_image_t *cups)
-{
-  unsigned char trash[4096];	/* Throwaway */
-  int block_count = amount / 4096;
-  int leftover = amount % 4096;
-  while (block_count > 0)
-    {
-      cupsRasterReadPixels(cups->ras, trash, 4096);
-      block_count--;
-    }
-  if (leftover)
-    cupsRasterReadPixels(cups->ras, trash, leftover);
-}
-
 static stp_image_status_t
 Image_get_row(stp_image_t   *image,	/* I - Image */
 	      unsigned char *data,	/* O - Row */
@@ -1557,14 +1811,11 @@ Image_get_row(stp_image_t   *image,	/* I - Image */
 	      int           row)	/* I - Row number (unused) */
 {
   cups_image_t	*cups;			/* CUPS image */
-  int		i;			/* Looping var */
   int 		bytes_per_line;
-  int		margin;
   stp_image_status_t tmp_image_status = Image_status;
-  unsigned char *orig = data;           /* Temporary pointer */
+  const unsigned char *line = NULL;	/* Row as read from the raster */
   static int warned = 0;                /* Error warning printed? */
   int new_percent;
-  int left_margin, right_margin;
 
   if ((cups = (cups_image_t *)(image->rep)) == NULL)
     {
@@ -1577,13 +1828,6 @@ Image_get_row(stp_image_t   *image,	/* I - Image */
     ((cups->adjusted_width * cups->header.cupsBitsPerPixel) + CHAR_BIT - 1) /
     CHAR_BIT;
 
-  left_margin = ((cups->left_trim * cups->header.cupsBitsPerPixel) + CHAR_BIT - 1) /
-    CHAR_BIT;
-  right_margin = ((cups->right_trim * cups->header.cupsBitsPerPixel) + CHAR_BIT - 1) /
-    CHAR_BIT;
-  margin = cups->header.cupsBytesPerLine - left_margin - bytes_per_line -
-    right_margin;
-
   if (cups->row < cups->header.cupsHeight)
   {
     if (! suppress_messages && ! suppress_verbose_messages)
@@ -1591,24 +1835,36 @@ Image_get_row(stp_image_t   *image,	/* I - Image */
 	      bytes_per_line, cups->row);
     while (cups->row <= row && cups->row < cups->header.cupsHeight)
       {
-	if (left_margin > 0)
+	line = raster_reader_next(cups->reader);
+	if (!line)
 	  {
-	    if (! suppress_messages && ! suppress_verbose_messages)
-	      fprintf(stderr, "DEBUG2: Gutenprint: Tossing left %d (%d)\n",
-		      left_margin, cups->left_trim);
-	    throwaway_data(left_margin, cups);
+	    cups->row = cups->header.cupsHeight;
+	    break;
 	  }
-	cupsRasterReadPixels(cups->ras, data, bytes_per_line);
 	cups->row ++;
-	if (margin + right_margin > 0)
-	  {
-	    if (! suppress_messages && ! suppress_verbose_messages)
-	      fprintf(stderr, "DEBUG2: Gutenprint: Tossing right %d (%d) + %d\n",
-		      right_margin, cups->right_trim, margin);
-	    throwaway_data(margin + right_margin, cups);
-	  }
       }
   }
+
+  /*
+   * This exists to print non-ADSC input which has messed up the job
+   * input, such as that generated by psnup.  The output is barely
+   * legible, but it's better than the garbage output otherwise.
+   * The reader has already expanded the row to one byte per pixel.
+   */
+  if (cups->header.cupsBitsPerPixel == 1)
+    {
+      if (warned == 0)
+	{
+	  fputs(_("WARNING: Gutenprint detected a bad color depth (1).  "
+		  "Output quality is degraded.  Are you using psnup or "
+		  "non-ADSC PostScript?\n"), stderr);
+	  warned = 1;
+	}
+      bytes_per_line = cups->adjusted_width;
+    }
+
+  if (line)
+    memcpy(data, line, bytes_per_line);
   else
     {
       switch (cups->header.cupsColorSpace)
@@ -1630,30 +1886,6 @@ Image_get_row(stp_image_t   *image,	/* I - Image */
 	}
     }
 
-  /*
-   * This exists to print non-ADSC input which has messed up the job
-   * input, such as that generated by psnup.  The output is barely
-   * legible, but it's better than the garbage output otherwise.
-   */
-  data = orig;
-  if (cups->header.cupsBitsPerPixel == 1)
-    {
-      if (warned == 0)
-	{
-	  fputs(_("WARNING: Gutenprint detected a bad color depth (1).  "
-		  "Output quality is degraded.  Are you using psnup or "
-		  "non-ADSC PostScript?\n"), stderr);
-	  warned = 1;
-	}
-      for (i = cups->adjusted_width - 1; i >= 0; i--)
-	{
-	  if ( (data[i/8] >> (7 - i%8)) &0x1)
-	    data[i]=255;
-	  else
-	    data[i]=0;
-	}
-    }
-
   new_percent = (int) (100.0 * cups->row / cups->header.cupsHeight);
   if (new_percent > cups->last_percent)
     {
@@ -60,6 +60,7 @@ typedef struct
   stpi_subchannel_t *sc;
   unsigned short *lut;
   const double *hue_map;
+  int *hue_table;		/* hue_map in 1/65536, plus the next point */
   size_t h_count;
   stp_curve_t *curve;
 } stpi_channel_t;
@@ -113,6 +114,7 @@ clear_a_channel(stpi_channel_group_t *cg, int channel)
     {
       STP_SAFE_FREE(cg->c[channel].sc);
       STP_SAFE_FREE(cg->c[channel].lut);
+      STP_SAFE_FREE(cg->c[channel].hue_table);
       if (cg->c[channel].curve)
 	{
 	  stp_curve_destroy(cg->c[channel].curve);
@@ -538,6 +540,15 @@ stp_channel_initialize(stp_vars_t *v, stp_image_t *image,
 	  curve_count++;
 	  stp_curve_resample(c->curve, 4096);
 	  c->hue_map = stp_curve_get_data(c->curve, &(c->h_count));
+	  c->hue_table = stp_malloc(sizeof(int) * (c->h_count + 1));
+	  for (j = 0; j < c->h_count; j++)
+	    c->hue_table[j] = (int) floor(c->hue_map[j] * 65536 + .5);
+	  /* A wrap-around curve carries its first point again at the end */
+	  if (stp_curve_get_wrap(c->curve) == STP_CURVE_WRAP_AROUND)
+	    c->hue_table[c->h_count] =
+	      (int) floor(c->hue_map[c->h_count] * 65536 + .5);
+	  else
+	    c->hue_table[c->h_count] = c->hue_table[c->h_count - 1];
 	  cg->curve_count++;
 	}
       if (sc > 1)
@@ -721,9 +732,16 @@ ink_sum(const unsigned short *data, int total_channels)
 {
   int j;
   unsigned total_ink = 0;
-  for (j = 0; j < total_channels; j++)
+  unsigned total_ink_1 = 0;
+  /* Two sums, so the adds don't all wait on each other */
+  for (j = 0; j + 1 < total_channels; j += 2)
+    {
+      total_ink += data[j];
+      total_ink_1 += data[j + 1];
+    }
+  if (j < total_channels)
     total_ink += data[j];
-  return total_ink;
+  return total_ink + total_ink_1;
 }
 
 static int NOINLINE
@@ -732,25 +750,29 @@ limit_ink(stpi_channel_group_t *cg)
   int i;
   int retval = 0;
   unsigned short *ptr;
+  int total_channels;
+  unsigned ink_limit;
   if (!cg || cg->ink_limit == 0 || cg->ink_limit >= cg->max_density)
     return 0;
   cg->valid_8bit = 0;
   ptr = cg->output_data;
+  total_channels = cg->total_channels;
+  ink_limit = cg->ink_limit;
   for (i = 0; i < cg->width; i++)
     {
-      int total_ink = ink_sum(ptr, cg->total_channels);
-      if (total_ink > cg->ink_limit) /* Need to limit ink? */
+      unsigned total_ink = ink_sum(ptr, total_channels);
+      if (total_ink > ink_limit) /* Need to limit ink? */
 	{
 	  int j;
 	  /*
 	   * FIXME we probably should first try to convert light ink to dark
 	   */
-	  double ratio = (double) cg->ink_limit / (double) total_ink;
-	  for (j = 0; j < cg->total_channels; j++)
+	  double ratio = (double) ink_limit / (double) total_ink;
+	  for (j = 0; j < total_channels; j++)
 	    ptr[j] *= ratio;
 	  retval = 1;
 	}
-      ptr += cg->total_channels;
+      ptr += total_channels;
    }
   return retval;
 }
@@ -808,33 +830,60 @@ copy_channels(stpi_channel_group_t *cg)
     }
 }
 
-static inline double
+/*
+ * Hue, scaled by max so that it stays an integer: 0 <= hue < 6 * max.
+ * c, m and y have had the gray component removed, so one is zero.
+ */
+static inline unsigned
 compute_hue(int c, int m, int y, int max)
 {
-  double h;
   if (max == c)
-    h = (m - y) / (double) max;
+    return m >= y ? m - y : 6 * max + m - y;
   else if (max == m)
-    h = 2 + ((y - c) / (double) max);
+    return 2 * max + y - c;
   else
-    h = 4 + ((c - m) / (double) max);
-  if (h < 0)
-    h += 6;
-  else if (h >= 6)
-    h -= 6;
-  return h;
+    return 4 * max + c - m;
 }
 
-static inline double
-interpolate_value(const double *vec, double val)
+/*
+ * Position of hue / max in a hue table of count points, as the point
+ * below it and the distance past that point in units of 1 / (6 * max).
+ */
+static inline void
+hue_position(unsigned hue, int max, size_t count, unsigned *base,
+	     unsigned *frac)
 {
-  double base = floor(val);
-  double frac = val - base;
-  int ibase = (int) base;
-  double lval = vec[ibase];
+  unsigned span = 6 * max;
+  if (hue <= UINT_MAX / count)
+    {
+      unsigned pos = hue * count;
+      *base = pos / span;
+      *frac = pos - *base * span;
+    }
+  else
+    {
+      unsigned long long pos = (unsigned long long) hue * count;
+      *base = pos / span;
+      *frac = pos - (unsigned long long) *base * span;
+    }
+}
+
+/*
+ * max times the hue map at that position, interpolated in fixed point;
+ * max cancels out of the interpolation term.
+ */
+static inline unsigned short
+interpolate_hue(const int *table, unsigned base, unsigned frac, int max)
+{
+  long long val = (long long) max * table[base];
   if (frac > 0)
-    lval += (vec[ibase + 1] - lval) * frac;
-  return lval;
+    val += ((long long) (table[base + 1] - table[base]) * frac) / 6;
+  val >>= 16;
+  if (val < 0)
+    return 0;
+  else if (val > 65535)
+    return 65535;
+  return (unsigned short) val;
 }
 
 static void NOINLINE
@@ -870,7 +919,10 @@ generate_special_channels(stpi_channel_group_t *cg)
 	  int max = FMAX(c, FMAX(m, y));
 	  if (max > min)	/* Otherwise it's gray, and we don't care */
 	    {
-	      double hue;
+	      unsigned hue;
+	      size_t count = 0;
+	      unsigned base = 0;
+	      unsigned frac = 0;
 	      /*
 	       * We're only interested in converting color components
 	       * to special inks.  We want to compute the hue and
@@ -888,10 +940,16 @@ generate_special_channels(stpi_channel_group_t *cg)
 	      for (j = 1; j < cg->aux_output_channels - offset; j++)
 		{
 		  stpi_channel_t *ch = &(cg->c[j]);
-		  if (ch->hue_map)
-		    output[j + offset] =
-		      max * interpolate_value(ch->hue_map,
-					      hue * ch->h_count / 6.0);
+		  if (ch->hue_table)
+		    {
+		      if (ch->h_count != count)
+			{
+			  count = ch->h_count;
+			  hue_position(hue, max, count, &base, &frac);
+			}
+		      output[j + offset] =
+			interpolate_hue(ch->hue_table, base, frac, max);
+		    }
 		  else
 		    output[j + offset] = 0;
 		}
@@ -162,7 +162,10 @@ typedef struct
   stp_cached_curve_t sat_map;
   unsigned short *gray_tmp;	/* Color -> Gray */
   unsigned short *cmy_tmp;	/* CMY -> CMYK */
-  unsigned char *in_data;
+  unsigned char *in_data;	/* Last row converted */
+  unsigned char *next_in_data;	/* Row being read */
+  unsigned row_zero_mask;	/* Zero mask of in_data */
+  int row_is_converted;		/* Channel data holds in_data's conversion */
 } lut_t;
 
 extern unsigned stpi_color_convert_to_gray(const stp_vars_t *v,
@@ -1152,6 +1152,84 @@ stp_curve_interpolate_value(const stp_curve_t *curve, double where,
   return 1;
 }
 
+/*
+ * Evaluate a (non-piecewise) curve at points evenly spaced across its
+ * whole range, as stp_curve_interpolate_value() would one at a time, but
+ * fetching the data, bounds and intervals only once.  The arithmetic is
+ * the same as interpolate_gamma_internal() and interpolate_point_internal()
+ * so the results are identical.
+ */
+static int
+interpolate_dense(const stp_curve_t *curve, int points, double *out)
+{
+  size_t count = stp_curve_count_points(curve);
+  size_t real_point_count = get_real_point_count(curve);
+  size_t point_count = get_point_count(curve);
+  const double *data;
+  size_t size;
+  double blo, bhi;
+  int i;
+
+  if (curve->piecewise)
+    return 0;
+  stp_sequence_get_data(curve->seq, &size, &data);
+  stp_sequence_get_bounds(curve->seq, &blo, &bhi);
+
+  if (curve->gamma)
+    {
+      double fgamma = curve->gamma;
+      int negative_gamma = 0;
+      if (fgamma < 0)
+	{
+	  negative_gamma = 1;
+	  fgamma = -fgamma;
+	}
+      for (i = 0; i < points; i++)
+	{
+	  double where = (double) i * (count - 1) / (points - 1);
+	  if (real_point_count)
+	    where /= (real_point_count - 1);
+	  if (negative_gamma)
+	    where = 1.0 - where;
+	  out[i] = blo + (bhi - blo) * pow(where, fgamma);
+	}
+      return 1;
+    }
+
+  if (curve->recompute_interval)
+    compute_intervals((stpi_cast_safe(curve)));
+  for (i = 0; i < points; i++)
+    {
+      double where = (double) i * (count - 1) / (points - 1);
+      int integer = where;
+      double frac = where - (double) integer;
+      if (integer >= size)
+	return 0;
+      if (frac == 0.0)
+	out[i] = data[integer];
+      else if (curve->curve_type == STP_CURVE_TYPE_LINEAR)
+	out[i] = data[integer] + frac * curve->interval[integer];
+      else
+	{
+	  int ip1 = integer + 1;
+	  double retval;
+	  if (ip1 >= point_count)
+	    ip1 -= point_count;
+	  if (ip1 >= size)
+	    return 0;
+	  retval = do_interpolate_spline(data[integer], data[ip1], frac,
+					 curve->interval[integer],
+					 curve->interval[ip1], 1.0);
+	  if (retval > bhi)
+	    retval = bhi;
+	  if (retval < blo)
+	    retval = blo;
+	  out[i] = retval;
+	}
+    }
+  return 1;
+}
+
 int
 stp_curve_resample(stp_curve_t *curve, size_t points)
 {
@@ -1189,6 +1267,7 @@ stp_curve_resample(stp_curve_t *curve, size_t points)
     {
       double blo, bhi;
       int curpos = 0;
+      int debug = stp_get_debug_level() & STP_DBG_CURVE;
       stp_sequence_get_bounds(curve->seq, &blo, &bhi);
       if (curve->recompute_interval)
 	compute_intervals(curve);
@@ -1242,9 +1321,10 @@ stp_curve_resample(stp_curve_t *curve, size_t points)
 		new_vec[curpos] = blo;
 	      if (new_vec[curpos] > bhi)
 		new_vec[curpos] = bhi;
-	      stp_deprintf(STP_DBG_CURVE,
-			   "  Filling slot %d %f %f\n",
-			   curpos, frac, new_vec[curpos]);
+	      if (debug)
+		stp_deprintf(STP_DBG_CURVE,
+			     "  Filling slot %d %f %f\n",
+			     curpos, frac, new_vec[curpos]);
 	      curpos++;
 	    }
 	}
@@ -1366,39 +1446,34 @@ interpolate_points(stp_curve_t *a, stp_curve_t *b,
 		   stp_curve_compose_t mode,
 		   int points, double *tmp_data)
 {
-  double pa, pb;
+  double *b_data = stp_malloc(sizeof(double) * points);
   int i;
-  size_t points_a = stp_curve_count_points(a);
-  size_t points_b = stp_curve_count_points(b);
+  if (!interpolate_dense(a, points, tmp_data) ||
+      !interpolate_dense(b, points, b_data))
+    {
+      stp_deprintf(STP_DBG_CURVE_ERRORS,
+		   "interpolate_points: interpolate curve value failed\n");
+      stp_free(b_data);
+      return 0;
+    }
   for (i = 0; i < points; i++)
     {
-      if (!stp_curve_interpolate_value
-	  (a, (double) i * (points_a - 1) / (points - 1), &pa))
-	{
-	  stp_deprintf(STP_DBG_CURVE_ERRORS,
-		       "interpolate_points: interpolate curve a value failed\n");
-	  return 0;
-	}
-      if (!stp_curve_interpolate_value
-	  (b, (double) i * (points_b - 1) / (points - 1), &pb))
-	{
-	  stp_deprintf(STP_DBG_CURVE_ERRORS,
-		       "interpolate_points: interpolate curve b value failed\n");
-	  return 0;
-	}
+      double pa = tmp_data[i];
       if (mode == STP_CURVE_COMPOSE_ADD)
-	pa += pb;
+	pa += b_data[i];
       else
-	pa *= pb;
+	pa *= b_data[i];
       if (! isfinite(pa))
 	{
 	  stp_deprintf(STP_DBG_CURVE_ERRORS,
 		       "interpolate_points: interpolated point %lu is invalid\n",
 		       (unsigned long) i);
+	  stp_free(b_data);
 	  return 0;
 	}
       tmp_data[i] = pa;
     }
+  stp_free(b_data);
   return 1;
 }
 
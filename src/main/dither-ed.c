@@ -329,15 +329,15 @@ print_color(const stpi_dither_t *d, stpi_dither_channel_t *dc, int x, int y,
   return adjusted;
 }
 
+/*
+ * Keep track of runs of empty lines.  Once the error has had a few
+ * lines to die out, clear it and skip dithering until something
+ * shows up again.  Returns 0 if this line needn't be dithered.
+ */
+
 static int
-shared_ed_initializer(stpi_dither_t *d,
-		      int row,
-		      int duplicate_line,
-		      int zero_mask,
-		      int length,
-		      int direction,
-		      int ****error,
-		      int **ndither)
+ed_line_needs_dither(stpi_dither_t *d, int row, int duplicate_line,
+		     int zero_mask)
 {
   int i, j;
   for (i = 0; i < CHANNEL_COUNT(d); i++)
@@ -362,6 +362,22 @@ shared_ed_initializer(stpi_dither_t *d,
 		 d->dst_width * sizeof(int));
       return 0;
     }
+  return 1;
+}
+
+static int
+shared_ed_initializer(stpi_dither_t *d,
+		      int row,
+		      int duplicate_line,
+		      int zero_mask,
+		      int length,
+		      int direction,
+		      int ****error,
+		      int **ndither)
+{
+  int i, j;
+  if (!ed_line_needs_dither(d, row, duplicate_line, zero_mask))
+    return 0;
   d->ptr_offset = (direction == 1) ? 0 : length - 1;
 
   *error = stp_malloc(CHANNEL_COUNT(d) * sizeof(int **));
@@ -396,6 +412,101 @@ shared_ed_deinitializer(stpi_dither_t *d,
   STP_SAFE_FREE(ndither);
 }
 
+/*
+ * Count how many pixels starting at x can be skipped outright.  A pixel
+ * with no ink in any channel and no error carried into it leaves every
+ * channel's state exactly as it found it, apart from picking up the
+ * error already waiting at the next pixel, so a run of them needn't
+ * go through print_color and update_dither at all.
+ */
+
+static inline int
+ed_zero_run(const stpi_dither_t *d, const unsigned short *raw, int ***error,
+	    const int *ndither, int x, int direction, int terminate,
+	    int xstep)
+{
+  int n = 0;
+  int i;
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    if (CHANNEL(d, i).ptr && (raw[i] || ndither[i]))
+      return 0;
+  for (x += direction, raw += direction * xstep, n = 1; x != terminate;
+       x += direction, raw += direction * xstep, n++)
+    for (i = 0; i < CHANNEL_COUNT(d); i++)
+      if (CHANNEL(d, i).ptr && (raw[i] || error[i][0][n * direction]))
+	return n;
+  return n;
+}
+
+/*
+ * The body of the error diffusion loop.  dither_type, direction, xmod
+ * and mask are constants in the common cases below, so each of those
+ * gets a copy of the loop with the tests on them folded away.
+ */
+
+static inline void
+ed_dither_row(stpi_dither_t *d, int row, const unsigned short *raw,
+	      const unsigned char *mask, int dither_type, int direction,
+	      int xstep, int xmod, int ***error, int *ndither)
+{
+  int		x,
+    		length;
+  unsigned char	bit;
+  int		i;
+  int		terminate;
+  int		xerror;
+
+  length = (d->dst_width + 7) / 8;
+  x = (direction == 1) ? 0 : d->dst_width - 1;
+  bit = 1 << (7 - (x & 7));
+  xerror = (xmod * x) % d->dst_width;
+  terminate = (direction == 1) ? d->dst_width : -1;
+
+  if (direction == -1)
+    raw += (CHANNEL_COUNT(d) * (d->src_width - 1));
+
+  for (; x != terminate; x += direction)
+    {
+      if (!xmod)
+	{
+	  int skip = ed_zero_run(d, raw, error, ndither, x, direction,
+				 terminate, xstep);
+	  if (skip > 0)
+	    {
+	      int j;
+	      x += skip * direction;
+	      raw += skip * direction * xstep;
+	      for (i = 0; i < CHANNEL_COUNT(d); i++)
+		{
+		  for (j = 0; j < d->error_rows; j++)
+		    error[i][j] += skip * direction;
+		  ndither[i] = error[i][0][0];
+		}
+	      if (x == terminate)
+		break;
+	      d->ptr_offset = x >> 3;
+	      bit = 1 << (7 - (x & 7));
+	    }
+	}
+      for (i = 0; i < CHANNEL_COUNT(d); i++)
+	{
+	  if (CHANNEL(d, i).ptr)
+	    {
+	      CHANNEL(d, i).v = raw[i];
+	      CHANNEL(d, i).o = CHANNEL(d, i).v;
+	      CHANNEL(d, i).b = CHANNEL(d, i).v;
+	      CHANNEL(d, i).v = UPDATE_COLOR(CHANNEL(d, i).v, ndither[i]);
+	      CHANNEL(d, i).v = print_color(d, &(CHANNEL(d, i)), x, row, bit,
+					    length, 0, dither_type, mask);
+	      ndither[i] = update_dither(d, i, d->src_width,
+					 direction, error[i][0], error[i][1]);
+	    }
+	}
+      ADVANCE_BIDIRECTIONAL(d, bit, raw, direction, CHANNEL_COUNT(d), xerror,
+			    xstep, xmod, error, d->error_rows);
+    }
+}
+
 void
 stpi_dither_ed(stp_vars_t *v,
 	       int row,
@@ -405,16 +516,13 @@ stpi_dither_ed(stp_vars_t *v,
 	       const unsigned char *mask)
 {
   stpi_dither_t *d = (stpi_dither_t *) stp_get_component_data(v, "Dither");
-  int		x,
-    		length;
-  unsigned char	bit;
+  int		length;
   int		i;
   int		*ndither;
   int		***error;
 
-  int		terminate;
   int		direction = row & 1 ? 1 : -1;
-  int xerror, xstep, xmod;
+  int xstep, xmod;
 
   length = (d->dst_width + 7) / 8;
   if (d->stpi_dither_type & D_ADAPTIVE_BASE)
@@ -428,37 +536,315 @@ stpi_dither_ed(stp_vars_t *v,
 			     direction, &error, &ndither))
     return;
 
-  x = (direction == 1) ? 0 : d->dst_width - 1;
-  bit = 1 << (7 - (x & 7));
   xstep  = CHANNEL_COUNT(d) * (d->src_width / d->dst_width);
   xmod   = d->src_width % d->dst_width;
-  xerror = (xmod * x) % d->dst_width;
-  terminate = (direction == 1) ? d->dst_width : -1;
 
+  if (mask || xmod ||
+      (d->stpi_dither_type != D_FLOYD_HYBRID &&
+       d->stpi_dither_type != D_ADAPTIVE_HYBRID))
+    ed_dither_row(d, row, raw, mask, d->stpi_dither_type, direction,
+		  xstep, xmod, error, ndither);
+  else if (d->stpi_dither_type == D_ADAPTIVE_HYBRID)
+    {
+      if (direction == 1)
+	ed_dither_row(d, row, raw, NULL, D_ADAPTIVE_HYBRID, 1,
+		      xstep, 0, error, ndither);
+      else
+	ed_dither_row(d, row, raw, NULL, D_ADAPTIVE_HYBRID, -1,
+		      xstep, 0, error, ndither);
+    }
+  else
+    {
+      if (direction == 1)
+	ed_dither_row(d, row, raw, NULL, D_FLOYD_HYBRID, 1,
+		      xstep, 0, error, ndither);
+      else
+	ed_dither_row(d, row, raw, NULL, D_FLOYD_HYBRID, -1,
+		      xstep, 0, error, ndither);
+    }
+  shared_ed_deinitializer(d, error, ndither);
   if (direction == -1)
-    raw += (CHANNEL_COUNT(d) * (d->src_width - 1));
+    stpi_dither_reverse_row_ends(d);
+}
+
+/*
+ * Hybrid Fast is the same hybrid as Floyd -- error diffusion decides
+ * whether to print, the pick matrix decides which drop size -- with
+ * the per-pixel work reduced to table lookups, shifts and compares.
+ * The segment an input value falls into comes from a 64K table per
+ * channel, and the error is spread with fixed power of two weights
+ * (1/2 to the next pixel, 1/4 below and 1/4 below and behind) rather
+ * than the density dependent spread Floyd uses.  Each channel is done
+ * across the whole row at once.  Rows with a mask go through
+ * stpi_dither_ed(), so the error carried to the next row is kept in the
+ * same units it uses (see UPDATE_COLOR).
+ */
+
+#define HF_NO_SEGMENT 255
+
+typedef struct
+{
+  unsigned lower_range;
+  unsigned range_span;
+  unsigned threshold;
+  unsigned lower_value;
+  unsigned upper_value;
+  unsigned lower_bits;
+  unsigned upper_bits;
+  int is_same_ink;
+} hf_segment_t;
+
+typedef struct
+{
+  unsigned char *segments;	/* Input value -> segment */
+  hf_segment_t *segs;
+} hf_channel_t;
+
+static void
+free_hybrid_fast_data(stpi_dither_t *d)
+{
+  hf_channel_t *hf = (hf_channel_t *) d->aux_data;
+  int i;
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    {
+      STP_SAFE_FREE(hf[i].segments);
+      STP_SAFE_FREE(hf[i].segs);
+    }
+  STP_SAFE_FREE(d->aux_data);
+}
+
+static void
+hf_setup(stpi_dither_t *d)
+{
+  hf_channel_t *hf = stp_zalloc(CHANNEL_COUNT(d) * sizeof(hf_channel_t));
+  int i, j, val;
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    {
+      stpi_dither_channel_t *dc = &(CHANNEL(d, i));
+      int levels = dc->nlevels;
+      if (levels <= 0 || levels >= HF_NO_SEGMENT)
+	continue;
+      hf[i].segs = stp_malloc(levels * sizeof(hf_segment_t));
+      for (j = 0; j < levels; j++)
+	{
+	  const stpi_dither_segment_t *dd = &(dc->ranges[j]);
+	  hf_segment_t *s = &(hf[i].segs[j]);
+	  unsigned virtual_value;
+	  if (dd->value_span == 0)
+	    virtual_value = dd->upper->value;
+	  else
+	    virtual_value = (dd->upper->value + dd->lower->value) / 2;
+	  s->lower_range = dd->lower->range;
+	  s->range_span = dd->range_span;
+	  s->threshold = virtual_value / 2;
+	  s->lower_value = dd->lower->value;
+	  s->upper_value = dd->upper->value;
+	  s->lower_bits = dd->lower->bits;
+	  s->upper_bits = dd->upper->bits;
+	  s->is_same_ink = dd->is_same_ink;
+	}
+      hf[i].segments = stp_malloc(65536);
+      hf[i].segments[0] = HF_NO_SEGMENT;
+      for (val = 1; val < 65536; val++)
+	{
+	  hf[i].segments[val] = HF_NO_SEGMENT;
+	  for (j = levels - 1; j >= 0; j--)
+	    if (val > dc->ranges[j].lower->range)
+	      {
+		hf[i].segments[val] = j;
+		break;
+	      }
+	}
+    }
+  d->aux_data = hf;
+  d->aux_freefunc = free_hybrid_fast_data;
+}
+
+/*
+ * Dither one channel across the row.  planes and direction are
+ * constants at each call site, so the compiler produces a separate
+ * loop for one and two bit output in each direction.
+ */
+
+static inline void
+hf_dither_channel(stpi_dither_t *d, stpi_dither_channel_t *dc,
+		  const hf_channel_t *hc, const unsigned short *input,
+		  int *err0, int *err1, int length, int planes, int direction,
+		  int xstep, int xmod)
+{
+  const unsigned *pick = dc->pick.matrix + dc->pick.last_y_mod;
+  int x_size = dc->pick.x_size;
+  int x = (direction == 1) ? 0 : d->dst_width - 1;
+  int terminate = (direction == 1) ? d->dst_width : -1;
+  int xerror = (xmod * x) % d->dst_width;
+  int xm = (x + dc->pick.x_offset) % x_size;
+  int byte = x >> 3;
+  unsigned bit = 1 << (7 - (x & 7));
+  unsigned acc0 = 0;
+  unsigned acc1 = 0;
+  int carry = 0;
+  int first = -1;
+  int last = -1;
+
+  if (xm < 0)
+    xm += x_size;
+  memset(err1 - 1, 0, (d->dst_width + 2) * sizeof(int));
 
   for (; x != terminate; x += direction)
     {
-      for (i = 0; i < CHANNEL_COUNT(d); i++)
+      unsigned val = *input;
+      int adjusted = 0;
+      int seg = hc->segments[val];
+      if (seg != HF_NO_SEGMENT)
 	{
-	  if (CHANNEL(d, i).ptr)
+	  const hf_segment_t *s = &(hc->segs[seg]);
+	  adjusted = UPDATE_COLOR(val + carry, err0[x]);
+	  if (adjusted > 0 && adjusted >= (int) s->threshold)
 	    {
-	      CHANNEL(d, i).v = raw[i];
-	      CHANNEL(d, i).o = CHANNEL(d, i).v;
-	      CHANNEL(d, i).b = CHANNEL(d, i).v;
-	      CHANNEL(d, i).v = UPDATE_COLOR(CHANNEL(d, i).v, ndither[i]);
-	      CHANNEL(d, i).v = print_color(d, &(CHANNEL(d, i)), x, row, bit,
-					    length, 0, d->stpi_dither_type,
-					    mask);
-	      ndither[i] = update_dither(d, i, d->src_width,
-					 direction, error[i][0], error[i][1]);
+	      unsigned delta = val - s->lower_range;
+	      int upper = s->is_same_ink ||
+		delta * 65535u >= pick[xm] * s->range_span;
+	      unsigned bits = upper ? s->upper_bits : s->lower_bits;
+	      adjusted -= upper ? s->upper_value : s->lower_value;
+	      acc0 |= bit & -(bits & 1);
+	      if (planes > 1)
+		acc1 |= bit & -((bits >> 1) & 1);
+	      if (bits)
+		{
+		  if (first == -1)
+		    first = x;
+		  last = x;
+		}
 	    }
 	}
-      ADVANCE_BIDIRECTIONAL(d, bit, raw, direction, CHANNEL_COUNT(d), xerror,
-			    xstep, xmod, error, d->error_rows);
+
+      /*
+       * Spread the error: half to the next pixel, a quarter straight
+       * down, and whatever is left below and behind.
+       */
+      carry = adjusted >> 1;
+      err1[x] += (adjusted >> 2) * 8;
+      err1[x - direction] += (adjusted - carry - (adjusted >> 2)) * 8;
+
+      if (direction == 1)
+	{
+	  bit >>= 1;
+	  if (++xm == x_size)
+	    xm = 0;
+	  input += xstep;
+	  if (xmod)
+	    {
+	      xerror += xmod;
+	      if (xerror >= d->dst_width)
+		{
+		  xerror -= d->dst_width;
+		  input += CHANNEL_COUNT(d);
+		}
+	    }
+	}
+      else
+	{
+	  bit <<= 1;
+	  if (--xm < 0)
+	    xm = x_size - 1;
+	  input -= xstep;
+	  if (xmod)
+	    {
+	      xerror -= xmod;
+	      if (xerror < 0)
+		{
+		  xerror += d->dst_width;
+		  input -= CHANNEL_COUNT(d);
+		}
+	    }
+	}
+      if (bit == 0 || bit == 256)
+	{
+	  dc->ptr[byte] |= acc0;
+	  if (planes > 1)
+	    dc->ptr[byte + length] |= acc1;
+	  acc0 = acc1 = 0;
+	  byte += direction;
+	  bit = (direction == 1) ? 128 : 1;
+	}
+    }
+  if (byte >= 0 && byte < length)
+    {
+      dc->ptr[byte] |= acc0;
+      if (planes > 1)
+	dc->ptr[byte + length] |= acc1;
+    }
+  if (first != -1)
+    {
+      dc->row_ends[0] = (direction == 1) ? first : last;
+      dc->row_ends[1] = (direction == 1) ? last : first;
+    }
+}
+
+void
+stpi_dither_ed_fast(stp_vars_t *v,
+		    int row,
+		    const unsigned short *raw,
+		    int duplicate_line,
+		    int zero_mask,
+		    const unsigned char *mask)
+{
+  stpi_dither_t *d = (stpi_dither_t *) stp_get_component_data(v, "Dither");
+  int direction = row & 1 ? 1 : -1;
+  int length = (d->dst_width + 7) / 8;
+  int xstep = CHANNEL_COUNT(d) * (d->src_width / d->dst_width);
+  int xmod = d->src_width % d->dst_width;
+  hf_channel_t *hf;
+  int general = mask != NULL;
+  int i;
+
+  /*
+   * Masks and more than two bits per pixel are rare enough that they
+   * can go through the general code.
+   */
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    if (CHANNEL(d, i).signif_bits > 2)
+      general = 1;
+  if (general)
+    {
+      stpi_dither_ed(v, row, raw, duplicate_line, zero_mask, mask);
+      return;
+    }
+
+  if (!d->aux_data)
+    hf_setup(d);
+  hf = (hf_channel_t *) d->aux_data;
+  if (!ed_line_needs_dither(d, row, duplicate_line, zero_mask))
+    return;
+
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    {
+      stpi_dither_channel_t *dc = &(CHANNEL(d, i));
+      const unsigned short *input = raw + i;
+      int *err0, *err1;
+      if (!dc->ptr || !hf[i].segments)
+	continue;
+      err0 = stpi_dither_get_errline(d, row, i);
+      err1 = stpi_dither_get_errline(d, row + 1, i);
+      if (direction == -1)
+	input += CHANNEL_COUNT(d) * (d->src_width - 1);
+      if (dc->signif_bits <= 1)
+	{
+	  if (direction == 1)
+	    hf_dither_channel(d, dc, &(hf[i]), input, err0, err1, length,
+			      1, 1, xstep, xmod);
+	  else
+	    hf_dither_channel(d, dc, &(hf[i]), input, err0, err1, length,
+			      1, -1, xstep, xmod);
+	}
+      else
+	{
+	  if (direction == 1)
+	    hf_dither_channel(d, dc, &(hf[i]), input, err0, err1, length,
+			      2, 1, xstep, xmod);
+	  else
+	    hf_dither_channel(d, dc, &(hf[i]), input, err0, err1, length,
+			      2, -1, xstep, xmod);
+	}
     }
-  shared_ed_deinitializer(d, error, ndither);
-  if (direction == -1)
-    stpi_dither_reverse_row_ends(d);
 }
@@ -396,54 +396,42 @@ print_ink(stpi_dither_t *d, unsigned char *tptr, const stpi_ink_defn_t *ink,
     }
 }
 
-void
-stpi_dither_et(stp_vars_t *v,
-	       int row,
-	       const unsigned short *raw,
-	       int duplicate_line,
-	       int zero_mask,
-	       const unsigned char *mask)
-{
-  stpi_dither_t *d = (stpi_dither_t *) stp_get_component_data(v, "Dither");
-  eventone_t *et;
+/*
+ * The body of the EvenTone loop.  hybrid, direction, xmod and mask are
+ * constants in the common cases below, so each of those gets a copy of
+ * the loop with the tests on them folded away.
+ */
 
+static inline void
+et_dither_row(stpi_dither_t *d, eventone_t *et, const unsigned short *raw,
+	      const unsigned char *mask, int hybrid, int direction,
+	      int xstep, int xmod)
+{
   int		x;
   int	        length;
   unsigned char	bit;
   int		i;
 
   int		terminate;
-  int		direction;
-  int		xerror, xstep, xmod;
+  int		xerror;
   int		channel_count = CHANNEL_COUNT(d);
 
-  if (!et_initializer(d, duplicate_line, zero_mask))
-    return;
-
-  et = (eventone_t *) d->aux_data;
-  if (d->stpi_dither_type & D_UNITONE)
-    stp_dither_matrix_set_row(&(et->transition_matrix), row);
-
   length = (d->dst_width + 7) / 8;
 
-  if (row & 1)
+  if (direction == 1)
     {
-      direction = 1;
       x = 0;
       terminate = d->dst_width;
       d->ptr_offset = 0;
     }
   else
     {
-      direction = -1;
       x = d->dst_width - 1;
       terminate = -1;
       d->ptr_offset = length - 1;
       raw += channel_count * (d->src_width - 1);
     }
   bit = 1 << (7 - (x & 7));
-  xstep  = channel_count * (d->src_width / d->dst_width);
-  xmod   = d->src_width % d->dst_width;
   xerror = (xmod * x) % d->dst_width;
 
   for (; x != terminate; x += direction)
@@ -452,7 +440,7 @@ stpi_dither_et(stp_vars_t *v,
       int point_error = 0;
       int comparison = 32768;
 
-      if (d->stpi_dither_type & D_ORDERED_BASE)
+      if (hybrid)
 	comparison += (ditherpoint(d, &(d->dither_matrix), x) / 16) - 2048;
 
       for (i=0; i < channel_count; i++)
@@ -519,6 +507,45 @@ stpi_dither_et(stp_vars_t *v,
     stpi_dither_reverse_row_ends(d);
 }
 
+void
+stpi_dither_et(stp_vars_t *v,
+	       int row,
+	       const unsigned short *raw,
+	       int duplicate_line,
+	       int zero_mask,
+	       const unsigned char *mask)
+{
+  stpi_dither_t *d = (stpi_dither_t *) stp_get_component_data(v, "Dither");
+  eventone_t *et;
+  int		hybrid = (d->stpi_dither_type & D_ORDERED_BASE) ? 1 : 0;
+  int		xstep  = CHANNEL_COUNT(d) * (d->src_width / d->dst_width);
+  int		xmod   = d->src_width % d->dst_width;
+
+  if (!et_initializer(d, duplicate_line, zero_mask))
+    return;
+
+  et = (eventone_t *) d->aux_data;
+  if (d->stpi_dither_type & D_UNITONE)
+    stp_dither_matrix_set_row(&(et->transition_matrix), row);
+
+  if (mask || xmod)
+    et_dither_row(d, et, raw, mask, hybrid, row & 1 ? 1 : -1, xstep, xmod);
+  else if (hybrid)
+    {
+      if (row & 1)
+	et_dither_row(d, et, raw, NULL, 1, 1, xstep, 0);
+      else
+	et_dither_row(d, et, raw, NULL, 1, -1, xstep, 0);
+    }
+  else
+    {
+      if (row & 1)
+	et_dither_row(d, et, raw, NULL, 0, 1, xstep, 0);
+      else
+	et_dither_row(d, et, raw, NULL, 0, -1, xstep, 0);
+    }
+}
+
 void
 stpi_dither_ut(stp_vars_t *v,
 	       int row,
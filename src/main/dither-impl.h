@@ -60,6 +60,7 @@ extern "C" {
 #define D_ORDERED_NEW 512
 #define D_ORDERED_SEGMENTED 1024
 #define D_ORDERED_SEGMENTED_NEW (D_ORDERED_SEGMENTED | D_ORDERED_NEW)
+#define D_HYBRID_FAST 2048
 #define D_INVALID -2
 
 #define DITHER_FAST_STEPS (6)
@@ -173,6 +174,9 @@ typedef struct dither
   stpi_ditherfunc_t *ditherfunc;
   void *aux_data;
   void (*aux_freefunc)(struct dither *);
+
+  int threads;			/* Worker threads for tiled dithering */
+  struct dither_tiles *tiles;
 } stpi_dither_t;
 
 #define CHANNEL(d, c) ((d)->channel[(c)])
@@ -185,14 +189,40 @@ extern stpi_ditherfunc_t stpi_dither_predithered;
 extern stpi_ditherfunc_t stpi_dither_very_fast;
 extern stpi_ditherfunc_t stpi_dither_ordered;
 extern stpi_ditherfunc_t stpi_dither_ed;
+extern stpi_ditherfunc_t stpi_dither_ed_fast;
 extern stpi_ditherfunc_t stpi_dither_et;
 extern stpi_ditherfunc_t stpi_dither_ut;
 
+/*
+ * Dither a range of columns [x_start, x_end) of the current row.
+ * x_start is always a multiple of 8, so tiles never share an output
+ * byte.  Row ends go to row_ends[2 * channel], not the channel itself.
+ */
+typedef void stpi_dither_tile_func_t(stpi_dither_t *d, int x_start, int x_end,
+				     int *row_ends, void *data);
+
+extern void stpi_dither_run_tiles(stpi_dither_t *d,
+				  stpi_dither_tile_func_t *func, void *data);
+extern void stpi_dither_tiles_destroy(stpi_dither_t *d);
+
+/* Row kernels shared by the ordered and very fast dithers */
+#define STPI_ORDERED_ONE_BIT	0
+#define STPI_ORDERED_LEVELS	1
+#define STPI_ORDERED_NEW	2
+#define STPI_ORDERED_VERY_FAST	3
+
+extern int stpi_dither_ordered_row_ok(const stpi_dither_t *d, int xmod,
+				      const unsigned char *mask);
+extern void stpi_dither_ordered_row(stpi_dither_t *d, const unsigned short *raw,
+				    int xstep, int length, int kind);
+
 extern void stpi_dither_reverse_row_ends(stpi_dither_t *d);
 extern int stpi_dither_translate_channel(stp_vars_t *v, unsigned channel,
 					 unsigned subchannel);
 extern void stpi_dither_channel_destroy(stpi_dither_channel_t *channel);
 extern void stpi_dither_finalize(stp_vars_t *v);
+extern int stpi_dither_set_standard_matrix(stp_vars_t *v, int x_aspect,
+					   int y_aspect, int transpose);
 extern int *stpi_dither_get_errline(stpi_dither_t *d, int row, int color);
 
 
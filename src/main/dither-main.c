@@ -64,6 +64,7 @@ static const stpi_dither_algorithm_t dither_algos[] =
   { "Fast",	      N_ ("Fast"),                   D_FAST },
   { "VeryFast",	      N_ ("Very Fast"),              D_VERY_FAST },
   { "Floyd",	      N_ ("Hybrid Floyd-Steinberg"), D_FLOYD_HYBRID },
+  { "HybridFast",     N_ ("Hybrid Fast"),            D_HYBRID_FAST },
   { "Predithered",    N_ ("Predithered Input"),      D_PREDITHERED },
   { "Segmented",      N_ ("Drop Size Segmented"),    D_ORDERED_SEGMENTED },
   { "SegmentedNew",   N_ ("Drop Size Segmented New"),D_ORDERED_SEGMENTED_NEW }
@@ -101,7 +102,8 @@ static const stp_parameter_t dither_parameters[] =
        "EvenTone is a new, experimental algorithm that often produces excellent results.\n"
        "Ordered is faster and produces almost as good quality on photographs.\n"
        "Fast and Very Fast are considerably faster, and work well for text and line art.\n"
-       "Hybrid Floyd-Steinberg generally produces inferior output."),
+       "Hybrid Floyd-Steinberg generally produces inferior output.\n"
+       "Hybrid Fast is a quicker, simplified Hybrid Floyd-Steinberg."),
     STP_PARAMETER_TYPE_STRING_LIST, STP_PARAMETER_CLASS_OUTPUT,
     STP_PARAMETER_LEVEL_ADVANCED, 1, 1, STP_CHANNEL_NONE, 1, 0
   },
@@ -272,6 +274,8 @@ stpi_set_dither_function(stp_vars_t *v)
     case D_HYBRID_UNITONE:
     case D_UNITONE:
       RETURN_DITHERFUNC(stpi_dither_ut, v);
+    case D_HYBRID_FAST:
+      RETURN_DITHERFUNC(stpi_dither_ed_fast, v);
     default:
       RETURN_DITHERFUNC(stpi_dither_ed, v);
     }
@@ -325,6 +329,7 @@ stpi_dither_free(void *vd)
 {
   stpi_dither_t *d = (stpi_dither_t *) vd;
   int j;
+  stpi_dither_tiles_destroy(d);
   if (d->aux_freefunc)
     (d->aux_freefunc)(d);
   for (j = 0; j < CHANNEL_COUNT(d); j++)
@@ -350,6 +355,7 @@ stp_dither_init(stp_vars_t *v, stp_image_t *image, int out_width,
   d->finalized = 0;
   d->error_rows = ERROR_ROWS;
   d->d_cutoff = 4096;
+  d->threads = stp_get_thread_count();
 
   d->offset0_table = NULL;
   d->offset1_table = NULL;
@@ -391,12 +397,10 @@ stp_dither_init(stp_vars_t *v, stp_image_t *image, int out_width,
     }
   else
     {
-      stp_array_t *array =
-	stp_find_standard_dither_array(d->y_aspect, d->x_aspect);
       int transposed = d->y_aspect < d->x_aspect ? 1 : 0;
-      STPI_ASSERT(array, v);
-      stp_dither_set_matrix_from_dither_array(v, array, transposed);
-      stp_array_destroy(array);
+      int found = stpi_dither_set_standard_matrix(v, d->y_aspect, d->x_aspect,
+						  transposed);
+      STPI_ASSERT(found, v);
     }
 
   d->src_width = in_width;
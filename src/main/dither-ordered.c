@@ -44,8 +44,16 @@ typedef struct {
   unsigned short mask;
   unsigned short x_mask;
   stpi_new_ordered_t *ord_new;
+  unsigned char *segments;	/* Input value -> dither segment, or 255 */
 } stpi_ordered_t;
 
+/*
+ * Most printers have at most a few bits per pixel; anything wider goes
+ * through the per-pixel code.
+ */
+#define MAX_ORDERED_PLANES 8
+#define NO_SEGMENT 255
+
 static int
 compare_channels(const stpi_dither_channel_t *dc1,
 		 const stpi_dither_channel_t *dc2)
@@ -279,6 +287,7 @@ free_dither_ordered(stpi_dither_t *d)
 		stp_free(no->lut);
 	      stp_free(no);
 	    }
+	  STP_SAFE_FREE(ord->segments);
 	  stp_free(dc->aux_data);
 	  dc->aux_data = NULL;
 	}
@@ -300,6 +309,7 @@ init_dither_ordered(stpi_dither_t *d, stp_vars_t *v)
       dc->aux_data = stp_malloc(sizeof(stpi_ordered_t));
       s = (stpi_ordered_t *) dc->aux_data;
       s->ord_new = NULL;
+      s->segments = NULL;
       if (d->stpi_dither_type & D_ORDERED_SEGMENTED)
 	{
 	  s->shift = 16 - dc->signif_bits;
@@ -326,6 +336,213 @@ init_dither_ordered(stpi_dither_t *d, stp_vars_t *v)
     }
 }
 
+/*
+ * The per-pixel code above spends most of its time finding the range
+ * an input value falls into and rescaling it against that range, and
+ * keeping ditherpoint()'s position in the matrix up to date.  When the
+ * output isn't masked or unevenly scaled, we can instead run each
+ * channel across the row eight pixels at a time, walking the current
+ * row of the dither matrix directly and accumulating whole output bytes
+ * for every bit plane, each of which is then written once.
+ *
+ * Nothing here depends on any other column, so the row can be split
+ * into tiles (on byte boundaries) and run on several threads; see
+ * stpi_dither_run_tiles().
+ */
+
+static void
+init_ordered_segments(stpi_dither_channel_t *dc)
+{
+  stpi_ordered_t *o = (stpi_ordered_t *) dc->aux_data;
+  int levels = dc->nlevels - 1;
+  int i, val;
+
+  o->segments = stp_malloc(65536);
+  o->segments[0] = NO_SEGMENT;
+  for (val = 1; val < 65536; val++)
+    {
+      o->segments[val] = NO_SEGMENT;
+      for (i = levels; i >= 0; i--)
+	if (val > dc->ranges[i].lower->value)
+	  {
+	    o->segments[val] = i;
+	    break;
+	  }
+    }
+}
+
+static inline void
+flush_ordered_block(int *row_ends, unsigned char *tptr, int length,
+		    const unsigned char *acc, int planes, int x)
+{
+  unsigned char any = 0;
+  int i;
+  for (i = 0; i < planes; i++)
+    if (acc[i])
+      {
+	tptr[i * length] |= acc[i];
+	any |= acc[i];
+      }
+  if (any)
+    {
+      int first = 0;
+      int last = 7;
+      while (!(any & (128 >> first)))
+	first++;
+      while (!(any & (128 >> last)))
+	last--;
+      if (row_ends[0] == -1)
+	row_ends[0] = x + first;
+      row_ends[1] = x + last;
+    }
+}
+
+typedef struct
+{
+  const unsigned short *raw;
+  int xstep;
+  int length;
+  int kind;
+} ordered_row_t;
+
+static void
+dither_ordered_tile(stpi_dither_t *d, int x_start, int x_end,
+		    int *row_ends, void *data)
+{
+  const ordered_row_t *r = (const ordered_row_t *) data;
+  int kind = r->kind;
+  int xstep = r->xstep;
+  int i;
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    {
+      stpi_dither_channel_t *dc = &CHANNEL(d, i);
+      const stpi_ordered_t *o = (const stpi_ordered_t *) dc->aux_data;
+      const stpi_new_ordered_t *ord = o ? o->ord_new : NULL;
+      const unsigned *matrix = dc->dithermat.matrix + dc->dithermat.last_y_mod;
+      int x_size = dc->dithermat.x_size;
+      int x_mod = (x_start + dc->dithermat.x_offset) % x_size;
+      const unsigned short *input = r->raw + x_start * xstep + i;
+      int levels = dc->nlevels - 1;
+      int planes = dc->signif_bits;
+      unsigned pattern = 0;
+      int x;
+
+      if (!dc->ptr)
+	continue;
+      if (kind == STPI_ORDERED_NEW && (levels < 1 || !ord))
+	continue;
+      if (kind == STPI_ORDERED_VERY_FAST)
+	{
+	  if (dc->nlevels > 0)
+	    pattern = dc->ranges[levels].upper->bits;
+	  if (!pattern)
+	    continue;
+	}
+
+      for (x = x_start; x < x_end; x += 8)
+	{
+	  unsigned char acc[MAX_ORDERED_PLANES];
+	  int n = x_end - x;
+	  int k, j;
+	  if (n > 8)
+	    n = 8;
+	  /* Nothing to print in an empty block; skip straight past it */
+	  for (k = 0; k < n && !input[k * xstep]; k++)
+	    ;
+	  if (k == n)
+	    {
+	      input += n * xstep;
+	      x_mod = (x_mod + n) % x_size;
+	      continue;
+	    }
+	  memset(acc, 0, planes);
+	  for (k = 0; k < n; k++, input += xstep)
+	    {
+	      unsigned val = *input;
+	      unsigned dpoint = matrix[x_mod];
+	      unsigned bits = 0;
+	      if (++x_mod == x_size)
+		x_mod = 0;
+	      if (!val)
+		continue;
+	      switch (kind)
+		{
+		case STPI_ORDERED_ONE_BIT:
+		  bits = val >= dpoint;
+		  break;
+		case STPI_ORDERED_VERY_FAST:
+		  if (val >= dpoint)
+		    bits = pattern;
+		  break;
+		case STPI_ORDERED_LEVELS:
+		  {
+		    unsigned seg = o->segments[val];
+		    const stpi_dither_segment_t *dd;
+		    if (seg == NO_SEGMENT)
+		      continue;
+		    dd = &(dc->ranges[seg]);
+		    /*
+		     * Same as rescaling (val - lower) to 0-65535 and comparing
+		     * that with dpoint, but without the divide.
+		     */
+		    if ((val - dd->lower->value) * 65535 >= dpoint * dd->value_span)
+		      bits = dd->upper->bits;
+		    else
+		      bits = dd->lower->bits;
+		  }
+		  break;
+		case STPI_ORDERED_NEW:
+		  {
+		    const unsigned short *where = ord->lut + (val * levels);
+		    for (j = levels - 1; j >= 0; j--)
+		      if (dpoint < where[j])
+			{
+			  bits = dc->ranges[j].upper->bits;
+			  break;
+			}
+		  }
+		  break;
+		}
+	      for (j = 0; bits && j < planes; j++, bits >>= 1)
+		if (bits & 1)
+		  acc[j] |= 128 >> k;
+	    }
+	  flush_ordered_block(row_ends + 2 * i, dc->ptr + (x >> 3), r->length,
+			      acc, planes, x);
+	}
+    }
+}
+
+int
+stpi_dither_ordered_row_ok(const stpi_dither_t *d, int xmod,
+			   const unsigned char *mask)
+{
+  int i;
+  if (mask || xmod)
+    return 0;
+  for (i = 0; i < CHANNEL_COUNT(d); i++)
+    {
+      const stpi_dither_channel_t *dc = &CHANNEL(d, i);
+      if (dc->dithermat.x_size <= 0 || dc->dithermat.x_offset < 0 ||
+	  dc->signif_bits > MAX_ORDERED_PLANES)
+	return 0;
+    }
+  return 1;
+}
+
+void
+stpi_dither_ordered_row(stpi_dither_t *d, const unsigned short *raw,
+			int xstep, int length, int kind)
+{
+  ordered_row_t r;
+  r.raw = raw;
+  r.xstep = xstep;
+  r.length = length;
+  r.kind = kind;
+  stpi_dither_run_tiles(d, dither_ordered_tile, &r);
+  d->ptr_offset = d->dst_width >> 3;
+}
+
 void
 stpi_dither_ordered(stp_vars_t *v,
 		    int row,
@@ -363,11 +580,29 @@ stpi_dither_ordered(stp_vars_t *v,
       if (dc->nlevels != 1 || dc->ranges[0].upper->bits != 1)
 	one_bit_only = 0;
     }
-  if (! one_bit_only && ! d->aux_data &&
-      (d->stpi_dither_type & (D_ORDERED_SEGMENTED | D_ORDERED_NEW)))
+  if (! one_bit_only && ! d->aux_data)
     init_dither_ordered(d, v);
 
-  if (one_bit_only)
+  if (!(d->stpi_dither_type & D_ORDERED_SEGMENTED) &&
+      stpi_dither_ordered_row_ok(d, xmod, mask))
+    {
+      int kind;
+      if (one_bit_only)
+	kind = STPI_ORDERED_ONE_BIT;
+      else if (one_level_only || !(d->stpi_dither_type == D_ORDERED_NEW))
+	kind = STPI_ORDERED_LEVELS;
+      else
+	kind = STPI_ORDERED_NEW;
+      if (kind == STPI_ORDERED_LEVELS)
+	for (i = 0; i < CHANNEL_COUNT(d); i++)
+	  {
+	    stpi_ordered_t *o = (stpi_ordered_t *) CHANNEL(d, i).aux_data;
+	    if (!o->segments)
+	      init_ordered_segments(&CHANNEL(d, i));
+	  }
+      stpi_dither_ordered_row(d, raw, xstep, length, kind);
+    }
+  else if (one_bit_only)
     {
       for (x = 0; x < d->dst_width; x ++)
 	{
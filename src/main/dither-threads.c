@@ -0,0 +1,152 @@
+/*
+ *
+ *   Tiled dithering across several threads
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Revision History:
+ *
+ *   See ChangeLog
+ */
+
+/*
+ * Dither algorithms with no dependencies between columns (ordered and
+ * very fast) can split a row into tiles and run them as tasks on the
+ * library's worker threads (see thread-pool.c).  Each tile writes only
+ * its own bytes of the output and keeps its own row ends; those are
+ * merged into the channels once every tile is done, so the result is
+ * identical to dithering the row in one piece.
+ *
+ * The number of tiles follows stp_get_thread_count() (default 1, which
+ * keeps the row whole).  Rows narrower than two minimum-width tiles are
+ * always done in one piece, since handing them off costs more than it
+ * saves.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <gutenprint/gutenprint.h>
+#include "gutenprint-internal.h"
+#include <gutenprint/gutenprint-intl-internal.h>
+#include "dither-impl.h"
+#include <string.h>
+
+#define MIN_TILE_WIDTH 2048
+
+typedef struct dither_tiles
+{
+  int *row_ends;		/* 2 * channels per tile */
+  int row_ends_size;
+} stpi_dither_tiles_t;
+
+typedef struct
+{
+  stpi_dither_t *d;
+  stpi_dither_tile_func_t *func;
+  void *data;
+  int *row_ends;
+  int tile_width;
+} stpi_dither_tile_job_t;
+
+static void
+run_one_tile(void *data, int tile)
+{
+  stpi_dither_tile_job_t *job = (stpi_dither_tile_job_t *) data;
+  stpi_dither_t *d = job->d;
+  int *row_ends = job->row_ends + tile * 2 * CHANNEL_COUNT(d);
+  int x_start = tile * job->tile_width;
+  int x_end = x_start + job->tile_width;
+  int i;
+  if (x_end > d->dst_width)
+    x_end = d->dst_width;
+  for (i = 0; i < 2 * CHANNEL_COUNT(d); i++)
+    row_ends[i] = -1;
+  (job->func)(d, x_start, x_end, row_ends, job->data);
+}
+
+static stpi_dither_tiles_t *
+get_tiles(stpi_dither_t *d, int ntiles)
+{
+  stpi_dither_tiles_t *t = d->tiles;
+  int size = ntiles * 2 * CHANNEL_COUNT(d);
+  if (!t)
+    {
+      t = stp_zalloc(sizeof(stpi_dither_tiles_t));
+      d->tiles = t;
+    }
+  if (size > t->row_ends_size)
+    {
+      STP_SAFE_FREE(t->row_ends);
+      t->row_ends = stp_malloc(sizeof(int) * size);
+      t->row_ends_size = size;
+    }
+  return t;
+}
+
+void
+stpi_dither_run_tiles(stpi_dither_t *d, stpi_dither_tile_func_t *func,
+		      void *data)
+{
+  int ntiles = 1;
+  int tile_width = d->dst_width;
+  stpi_dither_tiles_t *t;
+  stpi_dither_tile_job_t job;
+  int i, j;
+
+  if (d->threads > 1 && d->dst_width >= 2 * MIN_TILE_WIDTH)
+    {
+      ntiles = d->dst_width / MIN_TILE_WIDTH;
+      if (ntiles > d->threads)
+	ntiles = d->threads;
+      tile_width = (((d->dst_width + ntiles - 1) / ntiles) + 7) & ~7;
+      ntiles = (d->dst_width + tile_width - 1) / tile_width;
+    }
+
+  t = get_tiles(d, ntiles);
+  job.d = d;
+  job.func = func;
+  job.data = data;
+  job.row_ends = t->row_ends;
+  job.tile_width = tile_width;
+  stpi_run_tasks(ntiles, run_one_tile, &job);
+
+  /*
+   * Tiles are in left to right order, so the first tile with anything
+   * printed gives the left end and the last one the right end.
+   */
+  for (i = 0; i < ntiles; i++)
+    {
+      const int *row_ends = t->row_ends + i * 2 * CHANNEL_COUNT(d);
+      for (j = 0; j < CHANNEL_COUNT(d); j++)
+	if (row_ends[2 * j] != -1)
+	  {
+	    stpi_dither_channel_t *dc = &CHANNEL(d, j);
+	    if (dc->row_ends[0] == -1)
+	      dc->row_ends[0] = row_ends[2 * j];
+	    dc->row_ends[1] = row_ends[2 * j + 1];
+	  }
+    }
+}
+
+void
+stpi_dither_tiles_destroy(stpi_dither_t *d)
+{
+  stpi_dither_tiles_t *t = d->tiles;
+  if (!t)
+    return;
+  STP_SAFE_FREE(t->row_ends);
+  stp_free(t);
+  d->tiles = NULL;
+}
@@ -83,6 +83,12 @@ stpi_dither_very_fast(stp_vars_t *v,
   xmod   = d->src_width % d->dst_width;
   xerror = 0;
 
+  if (stpi_dither_ordered_row_ok(d, xmod, mask))
+    {
+      stpi_dither_ordered_row(d, raw, xstep, length, STPI_ORDERED_VERY_FAST);
+      return;
+    }
+
   bit_patterns = stp_zalloc(sizeof(unsigned char) * CHANNEL_COUNT(d));
   for (i = 0; i < CHANNEL_COUNT(d); i++)
     {
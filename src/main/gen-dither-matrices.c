@@ -0,0 +1,171 @@
+/*
+ *
+ *   Convert the standard dither matrices to C source
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reads the dither matrix XML files named on the command line and writes
+ * a header with their contents as constant arrays, which is compiled into
+ * libgutenprint so that the standard matrices don't have to be parsed at
+ * run time.  This runs before libgutenprint is built, so it can't use the
+ * library's XML parser; the files are simple enough to pick apart by hand.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *
+read_file(const char *name)
+{
+  FILE *fp = fopen(name, "r");
+  char *buf = NULL;
+  size_t size = 0;
+  size_t len = 0;
+  size_t bytes;
+
+  if (!fp)
+    return NULL;
+  do
+    {
+      if (len + 1 >= size)
+	{
+	  size = size ? size * 2 : 65536;
+	  buf = realloc(buf, size);
+	  if (!buf)
+	    {
+	      fclose(fp);
+	      return NULL;
+	    }
+	}
+      bytes = fread(buf + len, 1, size - len - 1, fp);
+      len += bytes;
+    }
+  while (bytes > 0);
+  buf[len] = '\0';
+  fclose(fp);
+  return buf;
+}
+
+/*
+ * Return the value of the first attr="value" after start, or -1.
+ */
+static long
+get_attr(const char *start, const char *attr)
+{
+  char pattern[64];
+  const char *where;
+  (void) snprintf(pattern, sizeof(pattern), "%s=\"", attr);
+  where = strstr(start, pattern);
+  if (!where)
+    return -1;
+  return strtol(where + strlen(pattern), NULL, 10);
+}
+
+static int
+convert_matrix(const char *name, char *names, size_t names_size)
+{
+  char *buf = read_file(name);
+  const char *matrix;
+  const char *array;
+  const char *seq;
+  char *data;
+  long x_aspect, y_aspect, x_size, y_size, count, lower, upper;
+  long i;
+
+  if (!buf)
+    {
+      fprintf(stderr, "gen-dither-matrices: cannot read %s\n", name);
+      return 0;
+    }
+  matrix = strstr(buf, "<dither-matrix");
+  array = matrix ? strstr(matrix, "<array") : NULL;
+  seq = array ? strstr(array, "<sequence") : NULL;
+  if (!seq)
+    {
+      fprintf(stderr, "gen-dither-matrices: %s is not a dither matrix\n",
+	      name);
+      free(buf);
+      return 0;
+    }
+  x_aspect = get_attr(matrix, "x-aspect");
+  y_aspect = get_attr(matrix, "y-aspect");
+  x_size = get_attr(array, "x-size");
+  y_size = get_attr(array, "y-size");
+  count = get_attr(seq, "count");
+  lower = get_attr(seq, "lower-bound");
+  upper = get_attr(seq, "upper-bound");
+  if (x_aspect < 1 || y_aspect < 1 || x_size < 1 || y_size < 1 ||
+      count != x_size * y_size || lower != 0 || upper != 65535)
+    {
+      fprintf(stderr, "gen-dither-matrices: %s: unexpected matrix layout\n",
+	      name);
+      free(buf);
+      return 0;
+    }
+
+  data = strchr(seq, '>');
+  if (!data)
+    {
+      free(buf);
+      return 0;
+    }
+  data++;
+  printf("/* From %s */\n", strrchr(name, '/') ? strrchr(name, '/') + 1 : name);
+  printf("static const unsigned short dither_matrix_%ldx%ld[%ld] =\n{",
+	 x_aspect, y_aspect, count);
+  for (i = 0; i < count; i++)
+    {
+      char *end;
+      long val = strtol(data, &end, 10);
+      if (end == data || val < lower || val > upper)
+	{
+	  fprintf(stderr, "gen-dither-matrices: %s: bad value at %ld\n",
+		  name, i);
+	  free(buf);
+	  return 0;
+	}
+      data = end;
+      if (i % 10 == 0)
+	printf("\n  ");
+      printf("%ld,%s", val, (i % 10 == 9 || i == count - 1) ? "" : " ");
+    }
+  printf("\n};\n\n");
+  (void) snprintf(names + strlen(names), names_size - strlen(names),
+		  "  { %ld, %ld, %ld, %ld, dither_matrix_%ldx%ld },\n",
+		  x_aspect, y_aspect, x_size, y_size, x_aspect, y_aspect);
+  free(buf);
+  return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+  char names[4096];
+  int i;
+
+  names[0] = '\0';
+  printf("/* Generated by gen-dither-matrices; do not edit. */\n\n");
+  for (i = 1; i < argc; i++)
+    if (!convert_matrix(argv[i], names, sizeof(names)))
+      return 1;
+  printf("static const stpi_builtin_dither_matrix_t builtin_dither_matrices[] =\n");
+  printf("{\n%s};\n", names);
+  return 0;
+}
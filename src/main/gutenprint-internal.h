@@ -55,6 +55,14 @@ extern void stpi_init_printer(void);
 #define BUFFER_FLAG_FLIP_Y	0x2
 extern stp_image_t* stpi_buffer_image(stp_image_t* image, unsigned int flags);
 
+/*
+ * Worker threads (thread-pool.c).  stpi_run_tasks() runs func on tasks
+ * 0 through ntasks - 1, some of them on other threads, and returns when
+ * all are done.
+ */
+typedef void stpi_task_func_t(void *data, int task);
+extern void stpi_run_tasks(int ntasks, stpi_task_func_t *func, void *data);
+
 #define STPI_ASSERT(x,v)						\
 do									\
 {									\
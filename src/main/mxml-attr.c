@@ -17,6 +17,7 @@
  *
  *   stp_mxmlElementGetAttr() - Get an attribute.
  *   stp_mxmlElementSetAttr() - Set an attribute.
+ *   mxml_arena_set_attr()    - Set an attribute of a node in an arena.
  */
 
 /*
@@ -27,6 +28,15 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include "mxml-internal.h"
+
+
+/*
+ * Local functions...
+ */
+
+static void	mxml_arena_set_attr(stp_mxml_node_t *node, const char *name,
+		                    const char *value);
 
 
 /*
@@ -94,6 +104,12 @@ stp_mxmlElementSetAttr(stp_mxml_node_t *node,	/* I - Element node */
   if (!node || node->type != STP_MXML_ELEMENT || !name || !value)
     return;
 
+  if (node->arena)
+  {
+    mxml_arena_set_attr(node, name, value);
+    return;
+  }
+
  /*
   * Look for the attribute...
   */
@@ -153,3 +169,63 @@ stp_mxmlElementSetAttr(stp_mxml_node_t *node,	/* I - Element node */
 
   node->value.element.num_attrs ++;
 }
+
+
+/*
+ * 'mxml_arena_set_attr()' - Set an attribute of a node in an arena.
+ *
+ * The strings and the attribute array come from the arena too; the
+ * ones they replace stay there until the arena is freed.
+ */
+
+static void
+mxml_arena_set_attr(stp_mxml_node_t *node,	/* I - Element node */
+                    const char  *name,	/* I - Name of attribute */
+                    const char  *value)	/* I - Attribute value */
+{
+  int		i;			/* Looping var */
+  stp_mxml_attr_t	*attr;			/* New attribute */
+  char		*copy;			/* Copy of value */
+
+
+  copy = stpi_mxml_arena_strndup(node->arena, value, strlen(value));
+
+  for (i = node->value.element.num_attrs, attr = node->value.element.attrs;
+       i > 0 && copy;
+       i --, attr ++)
+    if (!strcmp(attr->name, name))
+    {
+      attr->value = copy;
+      return;
+    }
+
+  attr = stpi_mxml_arena_alloc(node->arena,
+                               (node->value.element.num_attrs + 1) *
+			       sizeof(stp_mxml_attr_t));
+
+  if (!copy || !attr)
+  {
+    fprintf(stderr, "Unable to allocate memory for attribute '%s' in element %s!\n",
+            name, node->value.element.name);
+    return;
+  }
+
+  if (node->value.element.num_attrs)
+    memcpy(attr, node->value.element.attrs,
+           node->value.element.num_attrs * sizeof(stp_mxml_attr_t));
+
+  node->value.element.attrs = attr;
+  attr += node->value.element.num_attrs;
+
+  if ((attr->name = stpi_mxml_arena_strndup(node->arena, name,
+                                            strlen(name))) == NULL)
+  {
+    fprintf(stderr, "Unable to allocate memory for attribute '%s' in element %s!\n",
+            name, node->value.element.name);
+    return;
+  }
+
+  attr->value = copy;
+
+  node->value.element.num_attrs ++;
+}
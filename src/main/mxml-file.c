@@ -24,6 +24,16 @@
  *   mxml_add_char()       - Add a character to a buffer, expanding as needed.
  *   mxml_file_getc()      - Get a character from a file.
  *   mxml_load_data()      - Load data into an XML node tree.
+ *   mxml_load_memory()    - Load data in memory into an arena.
+ *   mxml_load_buffer()    - Load data in memory into an XML node tree.
+ *   mxml_load_attrs()     - Load the attributes of an element from memory.
+ *   mxml_loader_add()     - Add characters to the loader's value buffer.
+ *   mxml_loader_add_utf8() - Add a Unicode character to the value buffer.
+ *   mxml_loader_set_attr() - Set an attribute of the current element.
+ *   mxml_intern()         - Look up or add an element or attribute name.
+ *   mxml_name_equal()     - Compare a name with characters in memory.
+ *   mxml_map_file()       - Map or read a whole file into memory.
+ *   mxml_read_stream()    - Read the rest of a file into memory.
  *   mxml_parse_element()  - Parse an element for any attributes...
  *   mxml_string_getc()    - Get a character from a string.
  *   mxml_write_node()     - Save an XML node to a file.
@@ -39,8 +49,37 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include "mxml-internal.h"
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #define MXML_BUFSIZE (64)
 #define ENTITY_BUFSIZE (64)
+#define MXML_READ_CHUNK (65536)
+#define MXML_NAMES_MIN (256)
+
+
+/*
+ * State kept while loading a document from memory...
+ */
+
+typedef struct mxml_loader_s
+{
+  stp_mxml_arena_t	*arena;			/* Arena for the document */
+  char			**names;		/* Hash table of names */
+  size_t		num_names,		/* Number of names */
+			names_size;		/* Size of hash table */
+  char			*buffer;		/* Value being collected */
+  size_t		buflen,			/* Length of value */
+			bufsize;		/* Size of buffer */
+  stp_mxml_attr_t	*attrs;			/* Attributes of current element */
+  int			num_attrs,		/* Number of attributes */
+			attrs_size;		/* Size of attribute array */
+} mxml_loader_t;
 
 /*
  * Local functions...
@@ -53,6 +92,27 @@ static int		mxml_file_putc(int ch, void *p);
 static stp_mxml_node_t	*mxml_load_data(stp_mxml_node_t *top, void *p,
 			                stp_mxml_type_t (*cb)(stp_mxml_node_t *),
 			                int (*getc_cb)(void *));
+static stp_mxml_node_t	*mxml_load_memory(const char *data, size_t length,
+			                  stp_mxml_type_t (*cb)(stp_mxml_node_t *));
+static stp_mxml_node_t	*mxml_load_buffer(mxml_loader_t *ld, const char *data,
+			                  size_t length,
+			                  stp_mxml_type_t (*cb)(stp_mxml_node_t *));
+static int		mxml_load_attrs(mxml_loader_t *ld, stp_mxml_node_t *node,
+			                const unsigned char **pp,
+					const unsigned char *end);
+static int		mxml_loader_add(mxml_loader_t *ld, const char *s,
+			                size_t len);
+static int		mxml_loader_add_utf8(mxml_loader_t *ld, int ch);
+static int		mxml_loader_set_attr(mxml_loader_t *ld, char *name,
+			                     const unsigned char *value,
+					     size_t len);
+static char		*mxml_intern(mxml_loader_t *ld, const unsigned char *s,
+			             size_t len);
+static int		mxml_name_equal(const char *name,
+			                const unsigned char *s, size_t len);
+static char		*mxml_map_file(const char *file, size_t *length,
+			               int *mapped);
+static char		*mxml_read_stream(FILE *fp, size_t *length);
 static int		mxml_parse_element(stp_mxml_node_t *node, void *p,
 			                   int (*getc_cb)(void *));
 static int		mxml_string_getc(void *p);
@@ -85,7 +145,21 @@ stp_mxmlLoadFile(stp_mxml_node_t *top,		/* I - Top node */
              stp_mxml_type_t (*cb)(stp_mxml_node_t *))
 					/* I - Callback function or STP_MXML_NO_CALLBACK */
 {
-  return (mxml_load_data(top, fp, cb, mxml_file_getc));
+  char			*data;		/* Contents of file */
+  size_t		length;		/* Length of contents */
+  stp_mxml_node_t	*doc;		/* Loaded document */
+
+
+  if (top)
+    return (mxml_load_data(top, fp, cb, mxml_file_getc));
+
+  if ((data = mxml_read_stream(fp, &length)) == NULL)
+    return (NULL);
+
+  doc = mxml_load_memory(data, length, cb);
+  free(data);
+
+  return (doc);
 }
 
 /*
@@ -105,8 +179,31 @@ stp_mxmlLoadFromFile(stp_mxml_node_t *top,	/* I - Top node */
 		     stp_mxml_type_t (*cb)(stp_mxml_node_t *))
 					/* I - Callback function or STP_MXML_NO_CALLBACK */
 {
-  FILE *fp = fopen(file, "r");
+  FILE *fp;
   stp_mxml_node_t *doc;
+  char *data;
+  size_t length;
+  int mapped;
+
+  if (!top)
+  {
+   /*
+    * Parse the whole file in memory, mapping it if we can...
+    */
+
+    if ((data = mxml_map_file(file, &length, &mapped)) == NULL)
+      return NULL;
+    doc = mxml_load_memory(data, length, cb);
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    if (mapped)
+      munmap(data, length);
+    else
+#endif
+      free(data);
+    return doc;
+  }
+
+  fp = fopen(file, "r");
   if (! fp)
     return NULL;
   doc = stp_mxmlLoadFile(top, fp, cb);
@@ -132,6 +229,9 @@ stp_mxmlLoadString(stp_mxml_node_t *top,	/* I - Top node */
                stp_mxml_type_t (*cb)(stp_mxml_node_t *))
 					/* I - Callback function or STP_MXML_NO_CALLBACK */
 {
+  if (!top)
+    return (mxml_load_memory(s, strlen(s), cb));
+
   return (mxml_load_data(top, &s, cb, mxml_string_getc));
 }
 
@@ -836,6 +936,980 @@ mxml_load_data(stp_mxml_node_t *top,	/* I - Top node */
 }
 
 
+/*
+ * 'mxml_load_memory()' - Load data in memory into an arena.
+ *
+ * The whole document is allocated from one arena, which is freed when
+ * the top node is deleted.
+ */
+
+static stp_mxml_node_t *			/* O - First node or NULL if the data could not be read. */
+mxml_load_memory(const char  *data,	/* I - Data to load */
+                 size_t      length,	/* I - Length of data */
+                 stp_mxml_type_t (*cb)(stp_mxml_node_t *))
+					/* I - Callback function or STP_MXML_NO_CALLBACK */
+{
+  mxml_loader_t		ld;		/* Loader state */
+  stp_mxml_node_t	*doc;		/* Loaded document */
+
+
+  memset(&ld, 0, sizeof(ld));
+
+  if ((ld.arena = stpi_mxml_arena_create()) == NULL)
+  {
+    fputs("Unable to allocate document arena!\n", stderr);
+    return (NULL);
+  }
+
+  doc = mxml_load_buffer(&ld, data, length, cb);
+
+  if (doc)
+    ld.arena->top = doc;
+  else
+    stpi_mxml_arena_destroy(ld.arena);
+
+  free(ld.names);
+  free(ld.buffer);
+  free(ld.attrs);
+
+  return (doc);
+}
+
+
+/*
+ * 'mxml_load_buffer()' - Load data in memory into an XML node tree.
+ *
+ * This builds the same tree that mxml_load_data() does, but scans
+ * the data directly instead of a character at a time through a
+ * callback, and takes names and values straight from the data where
+ * it can.
+ */
+
+static stp_mxml_node_t *			/* O - First node or NULL if the data could not be read. */
+mxml_load_buffer(mxml_loader_t *ld,	/* I - Loader state */
+                 const char  *data,	/* I - Data to load */
+                 size_t      length,	/* I - Length of data */
+                 stp_mxml_type_t (*cb)(stp_mxml_node_t *))
+					/* I - Callback function or STP_MXML_NO_CALLBACK */
+{
+  const unsigned char	*p,		/* Current position in data */
+			*end,		/* End of data */
+			*start,		/* Start of tag or string */
+			*q;		/* Scanning pointer */
+  stp_mxml_node_t	*node,		/* Current node */
+			*parent;	/* Current parent node */
+  stp_mxml_arena_t	*arena;		/* Arena for the document */
+  char			*name;		/* Element name */
+  int			ch,		/* Current character */
+			whitespace,	/* Non-zero if whitespace seen */
+			comment,	/* Non-zero if tag is a comment */
+			error;		/* Non-zero if out of memory */
+  stp_mxml_type_t	type;		/* Current node type */
+
+
+  p          = (const unsigned char *)data;
+  end        = p + length;
+  arena      = ld->arena;
+  parent     = NULL;
+  whitespace = 0;
+  error      = 0;
+  type       = STP_MXML_TEXT;
+
+  while (p < end)
+  {
+    ch = *p++;
+
+    if ((ch == '<' || (isspace(ch) && type != STP_MXML_OPAQUE)) &&
+        ld->buflen > 0)
+    {
+     /*
+      * Add a new value node...
+      */
+
+      char	*bufptr;		/* End of number */
+
+
+      ld->buffer[ld->buflen] = '\0';
+      bufptr = ld->buffer + ld->buflen;
+      node   = NULL;
+
+      switch (type)
+      {
+	case STP_MXML_INTEGER :
+	    {
+	      int integer = strtol(ld->buffer, &bufptr, 0);
+
+	      if (parent &&
+	          (node = stpi_mxml_arena_new_node(arena, parent, type)) != NULL)
+		node->value.integer = integer;
+	    }
+	    break;
+
+	case STP_MXML_OPAQUE :
+	    if (parent &&
+	        (node = stpi_mxml_arena_new_node(arena, parent, type)) != NULL)
+	      node->value.opaque = stpi_mxml_arena_strndup(arena, ld->buffer,
+							   ld->buflen);
+	    break;
+
+	case STP_MXML_REAL :
+	case STP_MXML_DIMENSION :
+	    {
+	      double real = strtod(ld->buffer, &bufptr);
+
+	      if (parent &&
+	          (node = stpi_mxml_arena_new_node(arena, parent,
+						   STP_MXML_REAL)) != NULL)
+		node->value.real = real;
+	    }
+	    break;
+
+	case STP_MXML_TEXT :
+	    if (parent &&
+	        (node = stpi_mxml_arena_new_node(arena, parent, type)) != NULL)
+	    {
+	      node->value.text.whitespace = whitespace;
+	      node->value.text.string     =
+		stpi_mxml_arena_strndup(arena, ld->buffer, ld->buflen);
+	    }
+	    break;
+
+        default : /* Should never happen... */
+	    break;
+      }
+
+      if (*bufptr)
+      {
+       /*
+        * Bad integer/real number value...
+	*/
+
+        fprintf(stderr, "Bad %s value '%s' in parent <%s>!\n",
+	        type == STP_MXML_INTEGER ? "integer" : "real", ld->buffer,
+		parent ? parent->value.element.name : "null");
+	break;
+      }
+
+      ld->buflen = 0;
+      whitespace = isspace(ch) && type == STP_MXML_TEXT;
+
+      if (!node)
+      {
+	fprintf(stderr, "Unable to add value node of type %d to parent <%s>!\n",
+	        type, parent ? parent->value.element.name : "null");
+	break;
+      }
+    }
+    else if (isspace(ch) && type == STP_MXML_TEXT)
+      whitespace = 1;
+
+   /*
+    * Add lone whitespace node if we have an element and existing
+    * whitespace...
+    */
+
+    if (ch == '<' && whitespace && type == STP_MXML_TEXT)
+    {
+      if (parent &&
+          (node = stpi_mxml_arena_new_node(arena, parent, type)) != NULL)
+      {
+	node->value.text.whitespace = whitespace;
+	node->value.text.string     = stpi_mxml_arena_strndup(arena, "", 0);
+      }
+
+      whitespace = 0;
+    }
+
+    if (ch == '<')
+    {
+     /*
+      * Start of open/close tag; find the end of the name...
+      */
+
+      comment = 0;
+
+      for (q = p; q < end; q ++)
+	if (isspace(*q) || *q == '>' || (*q == '/' && q > p))
+	  break;
+	else if (q == p + 2 && !strncmp((const char *)p, "!--", 3))
+	{
+	  comment = 1;
+	  q ++;
+	  break;
+	}
+
+      start = p;
+      p     = q;
+
+      if (comment)
+      {
+       /*
+        * Find the end of the comment...
+	*/
+
+	while ((q = memchr(q, '>', end - q)) != NULL &&
+	       (q - start <= 4 || q[-1] != '-' || q[-2] != '-'))
+	  q ++;
+
+	if (!q)
+	  break;
+
+	if ((node = stpi_mxml_arena_new_node(arena, parent,
+					     STP_MXML_ELEMENT)) == NULL)
+	{
+	  fprintf(stderr, "Unable to add comment node to parent <%s>!\n",
+	          parent ? parent->value.element.name : "null");
+	  break;
+	}
+
+	node->value.element.name =
+	  stpi_mxml_arena_strndup(arena, (const char *)start, q - start);
+	p = q + 1;
+      }
+      else if (p > start && start[0] == '!')
+      {
+       /*
+        * Declaration; the rest of it, up to the >, is the name...
+	*/
+
+	if ((q = memchr(p, '>', end - p)) == NULL)
+	  break;
+
+	if ((node = stpi_mxml_arena_new_node(arena, parent,
+					     STP_MXML_ELEMENT)) == NULL)
+	{
+	  fprintf(stderr, "Unable to add declaration node to parent <%s>!\n",
+	          parent ? parent->value.element.name : "null");
+	  break;
+	}
+
+	node->value.element.name =
+	  stpi_mxml_arena_strndup(arena, (const char *)start, q - start);
+	p = q + 1;
+
+       /*
+	* Descend into this node, setting the value type as needed...
+	*/
+
+	parent = node;
+
+	if (cb && parent)
+	  type = (*cb)(parent);
+      }
+      else if (p > start && start[0] == '/')
+      {
+       /*
+        * Handle close tag...
+	*/
+
+        if (!parent ||
+	    !mxml_name_equal(parent->value.element.name, start + 1,
+			     p - start - 1))
+	{
+	  fprintf(stderr, "Mismatched close tag <%.*s> under parent <%s>!\n",
+	          (int)(p - start), start,
+		  parent ? parent->value.element.name : "(null)");
+          break;
+	}
+
+	if ((q = memchr(p, '>', end - p)) != NULL)
+	  p = q + 1;
+	else
+	  p = end;
+
+       /*
+	* Ascend into the parent and set the value type as needed...
+	*/
+
+	parent = parent->parent;
+
+	if (cb && parent)
+	  type = (*cb)(parent);
+      }
+      else
+      {
+       /*
+        * Handle open tag...
+	*/
+
+	if ((name = mxml_intern(ld, start, p - start)) == NULL ||
+	    (node = stpi_mxml_arena_new_node(arena, parent,
+					     STP_MXML_ELEMENT)) == NULL)
+	{
+	  fprintf(stderr, "Unable to add element node to parent <%s>!\n",
+	          parent ? parent->value.element.name : "null");
+	  break;
+	}
+
+	node->value.element.name = name;
+
+	ch = p < end ? *p++ : EOF;
+
+        if (isspace(ch))
+          ch = mxml_load_attrs(ld, node, &p, end);
+        else if (ch == '/')
+	{
+	  if ((ch = p < end ? *p++ : EOF) != '>')
+	  {
+	    fprintf(stderr, "Expected > but got '%c' instead for element <%s/>!\n",
+	            ch, name);
+            break;
+	  }
+
+	  ch = '/';
+	}
+
+	if (ch == EOF)
+	  break;
+
+        if (ch != '/')
+	{
+	 /*
+	  * Descend into this node, setting the value type as needed...
+	  */
+
+	  parent = node;
+
+	  if (cb && parent)
+	    type = (*cb)(parent);
+	}
+      }
+    }
+    else if (ch == '&')
+    {
+     /*
+      * Add character entity to current buffer...  Currently we only
+      * support &lt;, &amp;, &gt;, &nbsp;, &quot;, &#nnn;, and &#xXXXX;...
+      */
+
+      char	entity[ENTITY_BUFSIZE],		/* Entity string */
+		*entptr;		/* Pointer into entity */
+
+
+      entity[0] = ch;
+      entptr    = entity + 1;
+
+      while ((ch = p < end ? *p++ : EOF) != EOF)
+        if (!isalnum(ch) && ch != '#')
+	  break;
+	else if (entptr < (entity + sizeof(entity) - 1))
+	  *entptr++ = ch;
+	else
+	{
+	  fprintf(stderr, "Entity name too long under parent <%s>!\n",
+	          parent ? parent->value.element.name : "null");
+          break;
+	}
+
+      *entptr = '\0';
+
+      if (ch != ';')
+      {
+	fprintf(stderr, "Entity name \"%s\" not terminated under parent <%s>!\n",
+	        entity, parent ? parent->value.element.name : "null");
+        break;
+      }
+
+      if (entity[1] == '#')
+      {
+	if (entity[2] == 'x')
+	  ch = strtol(entity + 3, NULL, 16);
+	else
+	  ch = strtol(entity + 2, NULL, 10);
+      }
+      else if (!strcmp(entity, "&amp"))
+        ch = '&';
+      else if (!strcmp(entity, "&gt"))
+        ch = '>';
+      else if (!strcmp(entity, "&lt"))
+        ch = '<';
+      else if (!strcmp(entity, "&nbsp"))
+        ch = 0xa0;
+      else if (!strcmp(entity, "&quot"))
+        ch = '\"';
+      else
+      {
+	fprintf(stderr, "Entity name \"%s;\" not supported under parent <%s>!\n",
+	        entity, parent ? parent->value.element.name : "null");
+        break;
+      }
+
+      if (mxml_loader_add_utf8(ld, ch))
+      {
+        error = 1;
+	break;
+      }
+    }
+    else if (type == STP_MXML_OPAQUE || !isspace(ch))
+    {
+     /*
+      * Add this character and the rest of the run to the current buffer...
+      */
+
+      start = p - 1;
+
+      if (type == STP_MXML_OPAQUE)
+      {
+	if ((q = memchr(p, '<', end - p)) == NULL)
+	  q = end;
+	if ((p = memchr(p, '&', q - p)) == NULL)
+	  p = q;
+      }
+      else
+	while (p < end && *p != '<' && *p != '&' && !isspace(*p))
+	  p ++;
+
+      if (mxml_loader_add(ld, (const char *)start, p - start))
+      {
+        error = 1;
+	break;
+      }
+    }
+    else
+    {
+     /*
+      * Whitespace between values; the rest of the run changes nothing...
+      */
+
+      while (p < end && isspace(*p))
+        p ++;
+    }
+  }
+
+  if (error)
+    return (NULL);
+
+ /*
+  * Find the top element and return it...
+  */
+
+  if (parent)
+  {
+    while (parent->parent)
+      parent = parent->parent;
+  }
+
+  return (parent);
+}
+
+
+/*
+ * 'mxml_load_attrs()' - Load the attributes of an element from memory.
+ *
+ * This follows mxml_parse_element().
+ */
+
+static int				/* O  - Terminating character */
+mxml_load_attrs(mxml_loader_t         *ld,	/* I  - Loader state */
+                stp_mxml_node_t       *node,	/* I  - Element node */
+                const unsigned char   **pp,	/* IO - Position in data */
+		const unsigned char   *end)	/* I  - End of data */
+{
+  const unsigned char	*p,		/* Position in data */
+			*value,		/* Attribute value */
+			*q;		/* End of quoted value */
+  char			*name;		/* Attribute name */
+  size_t		len;		/* Length of name or value */
+  int			ch,		/* Current character */
+			quote;		/* Quoting character */
+
+
+  p             = *pp;
+  ld->num_attrs = 0;
+
+ /*
+  * Loop until we hit a >, /, ?, or EOF...
+  */
+
+  for (;;)
+  {
+    if (p >= end)
+    {
+      ch = EOF;
+      break;
+    }
+
+    ch = *p++;
+
+   /*
+    * Skip leading whitespace...
+    */
+
+    if (isspace(ch))
+      continue;
+
+   /*
+    * Stop at /, ?, or >...
+    */
+
+    if (ch == '/' || ch == '?')
+    {
+      quote = p < end ? *p++ : EOF;
+
+      if (quote != '>')
+      {
+        fprintf(stderr, "Expected '>' after '%c' for element %s, but got '%c'!\n",
+	        ch, node->value.element.name, quote);
+        ch = EOF;
+      }
+
+      break;
+    }
+    else if (ch == '>')
+      break;
+
+   /*
+    * Read the attribute name...
+    */
+
+    value = p - 1;
+
+    while (p < end && !isspace(*p) && *p != '=' && *p != '/' && *p != '>' &&
+           *p != '?')
+      p ++;
+
+    name = mxml_intern(ld, value, p - value);
+    ch   = p < end ? *p++ : EOF;
+
+    if (ch == '=')
+    {
+     /*
+      * Read the attribute value...
+      */
+
+      if (p >= end)
+      {
+        fprintf(stderr, "Missing value for attribute '%s' in element %s!\n",
+	        name ? name : "", node->value.element.name);
+	ch = EOF;
+	break;
+      }
+
+      ch = *p++;
+
+      if (ch == '\'' || ch == '\"')
+      {
+       /*
+        * Read quoted value...
+	*/
+
+        quote = ch;
+	value = p;
+
+	if ((q = memchr(p, quote, end - p)) != NULL)
+	{
+	  len = q - p;
+	  p   = q + 1;
+	}
+	else
+	{
+	  len = end - p;
+	  p   = end;
+	  ch  = EOF;
+	}
+      }
+      else
+      {
+       /*
+        * Read unquoted value...
+	*/
+
+	value = p - 1;
+
+	while (p < end && !isspace(*p) && *p != '=' && *p != '/' && *p != '>')
+	  p ++;
+
+	len = p - value;
+	ch  = p < end ? *p++ : EOF;
+      }
+    }
+    else
+    {
+      value = (const unsigned char *)"";
+      len   = 0;
+    }
+
+   /*
+    * Save last character in case we need it...
+    */
+
+    if (ch == '/' || ch == '?')
+    {
+      quote = p < end ? *p++ : EOF;
+
+      if (quote != '>')
+      {
+        fprintf(stderr, "Expected '>' after '%c' for element %s, but got '%c'!\n",
+	        ch, node->value.element.name, quote);
+        ch = EOF;
+      }
+
+      break;
+    }
+    else if (ch == '>')
+      break;
+
+   /*
+    * Set the attribute...
+    */
+
+    if (!name || mxml_loader_set_attr(ld, name, value, len))
+      fprintf(stderr, "Unable to allocate memory for attribute in element %s!\n",
+              node->value.element.name);
+  }
+
+ /*
+  * Copy the attributes into the element...
+  */
+
+  if (ld->num_attrs > 0)
+  {
+    if ((node->value.element.attrs =
+           stpi_mxml_arena_alloc(ld->arena, ld->num_attrs *
+				 sizeof(stp_mxml_attr_t))) != NULL)
+    {
+      memcpy(node->value.element.attrs, ld->attrs,
+             ld->num_attrs * sizeof(stp_mxml_attr_t));
+      node->value.element.num_attrs = ld->num_attrs;
+    }
+    else
+      fprintf(stderr, "Unable to allocate memory for attributes in element %s!\n",
+              node->value.element.name);
+  }
+
+  *pp = p;
+
+  return (ch);
+}
+
+
+/*
+ * 'mxml_loader_add()' - Add characters to the loader's value buffer.
+ *
+ * The buffer always has room left for a terminating nul.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mxml_loader_add(mxml_loader_t *ld,	/* I - Loader state */
+                const char    *s,	/* I - Characters to add */
+		size_t        len)	/* I - Number of characters */
+{
+  char		*newbuffer;		/* New buffer value */
+  size_t	size;			/* New buffer size */
+
+
+  if (ld->buflen + len >= ld->bufsize)
+  {
+    size = ld->bufsize ? ld->bufsize : MXML_BUFSIZE;
+
+    while (ld->buflen + len >= size)
+      size *= 2;
+
+    if ((newbuffer = realloc(ld->buffer, size)) == NULL)
+    {
+      fprintf(stderr, "Unable to expand string buffer to %lu bytes!\n",
+	      (unsigned long) size);
+
+      return (-1);
+    }
+
+    ld->buffer  = newbuffer;
+    ld->bufsize = size;
+  }
+
+  memcpy(ld->buffer + ld->buflen, s, len);
+  ld->buflen += len;
+
+  return (0);
+}
+
+
+/*
+ * 'mxml_loader_add_utf8()' - Add a Unicode character to the value buffer.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mxml_loader_add_utf8(mxml_loader_t *ld,	/* I - Loader state */
+                     int           ch)	/* I - Character to add */
+{
+  char		utf8[4];		/* Encoded character */
+  size_t	len;			/* Length of encoding */
+
+
+  if (ch < 128)
+  {
+   /*
+    * Plain ASCII doesn't need special encoding...
+    */
+
+    utf8[0] = ch;
+    len     = 1;
+  }
+  else if (ch < 2048)
+  {
+    utf8[0] = 0xc0 | (ch >> 6);
+    utf8[1] = 0x80 | (ch & 63);
+    len     = 2;
+  }
+  else if (ch < 65536)
+  {
+    utf8[0] = 0xe0 | (ch >> 12);
+    utf8[1] = 0x80 | ((ch >> 6) & 63);
+    utf8[2] = 0x80 | (ch & 63);
+    len     = 3;
+  }
+  else
+  {
+    utf8[0] = 0xf0 | (ch >> 18);
+    utf8[1] = 0x80 | ((ch >> 12) & 63);
+    utf8[2] = 0x80 | ((ch >> 6) & 63);
+    utf8[3] = 0x80 | (ch & 63);
+    len     = 4;
+  }
+
+  return (mxml_loader_add(ld, utf8, len));
+}
+
+
+/*
+ * 'mxml_loader_set_attr()' - Set an attribute of the current element.
+ *
+ * As with stp_mxmlElementSetAttr(), a repeated attribute replaces the
+ * value of the first one.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+mxml_loader_set_attr(mxml_loader_t       *ld,	/* I - Loader state */
+                     char                *name,	/* I - Interned name */
+                     const unsigned char *value,/* I - Value */
+		     size_t              len)	/* I - Length of value */
+{
+  int			i;		/* Looping var */
+  char			*copy;		/* Copy of value */
+  stp_mxml_attr_t	*attrs;		/* New attribute array */
+
+
+  if ((copy = stpi_mxml_arena_strndup(ld->arena, (const char *)value,
+                                      len)) == NULL)
+    return (-1);
+
+  for (i = 0; i < ld->num_attrs; i ++)
+    if (!strcmp(ld->attrs[i].name, name))
+    {
+      ld->attrs[i].value = copy;
+      return (0);
+    }
+
+  if (ld->num_attrs == ld->attrs_size)
+  {
+    i = ld->attrs_size ? ld->attrs_size * 2 : 8;
+
+    if ((attrs = realloc(ld->attrs, i * sizeof(stp_mxml_attr_t))) == NULL)
+      return (-1);
+
+    ld->attrs      = attrs;
+    ld->attrs_size = i;
+  }
+
+  ld->attrs[ld->num_attrs].name  = name;
+  ld->attrs[ld->num_attrs].value = copy;
+  ld->num_attrs ++;
+
+  return (0);
+}
+
+
+/*
+ * 'mxml_intern()' - Look up or add an element or attribute name.
+ *
+ * Element and attribute names repeat many times in a document, so each
+ * different name is stored once and shared.  If the table can't grow
+ * the name is just copied.
+ */
+
+static char *				/* O - Name or NULL */
+mxml_intern(mxml_loader_t       *ld,	/* I - Loader state */
+            const unsigned char *s,	/* I - Name */
+	    size_t              len)	/* I - Length of name */
+{
+  const unsigned char	*nul;		/* Nul in name */
+  char			*name,		/* Name in table */
+			**names;	/* New hash table */
+  size_t		i, j,		/* Looping vars */
+			size,		/* Size of new table */
+			hash;		/* Hash of name */
+
+
+ /*
+  * Names end at a nul, as they would have when read a character at a
+  * time...
+  */
+
+  if ((nul = memchr(s, '\0', len)) != NULL)
+    len = nul - s;
+
+  if ((ld->num_names + 1) * 2 > ld->names_size)
+  {
+   /*
+    * Grow the table...
+    */
+
+    size = ld->names_size ? ld->names_size * 2 : MXML_NAMES_MIN;
+
+    if ((names = calloc(size, sizeof(char *))) == NULL)
+      return (stpi_mxml_arena_strndup(ld->arena, (const char *)s, len));
+
+    for (i = 0; i < ld->names_size; i ++)
+      if ((name = ld->names[i]) != NULL)
+      {
+	for (hash = 2166136261U, j = 0; name[j]; j ++)
+	  hash = (hash ^ (unsigned char)name[j]) * 16777619U;
+
+	for (j = hash & (size - 1); names[j]; j = (j + 1) & (size - 1));
+	names[j] = name;
+      }
+
+    free(ld->names);
+    ld->names      = names;
+    ld->names_size = size;
+  }
+
+  for (hash = 2166136261U, i = 0; i < len; i ++)
+    hash = (hash ^ s[i]) * 16777619U;
+
+  for (i = hash & (ld->names_size - 1);
+       (name = ld->names[i]) != NULL;
+       i = (i + 1) & (ld->names_size - 1))
+    if (!strncmp(name, (const char *)s, len) && name[len] == '\0')
+      return (name);
+
+  if ((name = stpi_mxml_arena_strndup(ld->arena, (const char *)s,
+                                      len)) != NULL)
+  {
+    ld->names[i] = name;
+    ld->num_names ++;
+  }
+
+  return (name);
+}
+
+
+/*
+ * 'mxml_name_equal()' - Compare a name with characters in memory.
+ */
+
+static int				/* O - Non-zero if equal */
+mxml_name_equal(const char          *name,	/* I - Name */
+                const unsigned char *s,		/* I - Characters */
+		size_t              len)	/* I - Number of characters */
+{
+  const unsigned char	*nul;		/* Nul in characters */
+
+
+  if ((nul = memchr(s, '\0', len)) != NULL)
+    len = nul - s;
+
+  return (!strncmp(name, (const char *)s, len) && name[len] == '\0');
+}
+
+
+/*
+ * 'mxml_map_file()' - Map or read a whole file into memory.
+ *
+ * Regular files are mapped where that's supported; anything else is
+ * read into an allocated buffer.  *mapped says which, so that the
+ * caller can unmap or free it.
+ */
+
+static char *				/* O - File contents or NULL */
+mxml_map_file(const char *file,		/* I - File to read */
+              size_t     *length,	/* O - Length of file */
+	      int        *mapped)	/* O - Non-zero if mapped */
+{
+  FILE		*fp;			/* File to read */
+  char		*data;			/* File contents */
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+  int		fd;			/* File descriptor */
+  struct stat	st;			/* File information */
+
+
+  if ((fd = open(file, O_RDONLY)) < 0)
+    return (NULL);
+
+  if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      (off_t)(size_t)st.st_size == st.st_size)
+  {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data != MAP_FAILED)
+    {
+      close(fd);
+      *length = (size_t)st.st_size;
+      *mapped = 1;
+      return (data);
+    }
+  }
+
+  close(fd);
+#endif
+
+  *mapped = 0;
+
+  if ((fp = fopen(file, "r")) == NULL)
+    return (NULL);
+
+  data = mxml_read_stream(fp, length);
+  fclose(fp);
+
+  return (data);
+}
+
+
+/*
+ * 'mxml_read_stream()' - Read the rest of a file into memory.
+ */
+
+static char *				/* O - Data or NULL */
+mxml_read_stream(FILE   *fp,		/* I - File to read from */
+                 size_t *length)	/* O - Number of bytes read */
+{
+  char		*data,			/* Data read */
+		*newdata;		/* Reallocated data */
+  size_t	size,			/* Size of buffer */
+		bytes;			/* Bytes read */
+
+
+  size    = MXML_READ_CHUNK;
+  *length = 0;
+
+  if ((data = malloc(size)) == NULL)
+  {
+    fputs("Unable to allocate file buffer!\n", stderr);
+    return (NULL);
+  }
+
+  while ((bytes = fread(data + *length, 1, size - *length, fp)) > 0)
+  {
+    *length += bytes;
+
+    if (*length == size)
+    {
+      if ((newdata = realloc(data, size * 2)) == NULL)
+      {
+        free(data);
+	fputs("Unable to expand file buffer!\n", stderr);
+	return (NULL);
+      }
+
+      data  = newdata;
+      size *= 2;
+    }
+  }
+
+  return (data);
+}
+
+
 /*
  * 'mxml_parse_element()' - Parse an element for any attributes...
  */
@@ -0,0 +1,49 @@
+/*
+ * Private definitions for mini-XML, a small XML-like file parsing library.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef GUTENPRINT_MXML_INTERNAL_H
+#  define GUTENPRINT_MXML_INTERNAL_H
+
+#  include <gutenprint/mxml.h>
+
+/*
+ * Documents loaded from a file or string are allocated from an arena:
+ * the nodes, their names, attributes and strings all come from a few
+ * large blocks, which are freed together when the top node of the
+ * document is deleted.  Deleting any other node of such a document only
+ * unlinks it.  New attribute values set on an arena node also come
+ * from the arena, and nodes created with stp_mxmlNew*() and added to
+ * the document are allocated and freed as usual.
+ */
+
+struct stp_mxml_arena_s
+{
+  stp_mxml_node_t	*top;			/* Deleting this node frees the arena */
+  void			*blocks;		/* Blocks allocated so far */
+  char			*next;			/* Free space in the current block */
+  size_t		left;			/* Bytes left in the current block */
+  size_t		block_size;		/* Size of the next block */
+};
+
+extern stp_mxml_arena_t	*stpi_mxml_arena_create(void);
+extern void		stpi_mxml_arena_destroy(stp_mxml_arena_t *arena);
+extern void		*stpi_mxml_arena_alloc(stp_mxml_arena_t *arena,
+					       size_t size);
+extern char		*stpi_mxml_arena_strndup(stp_mxml_arena_t *arena,
+						 const char *s, size_t len);
+extern stp_mxml_node_t	*stpi_mxml_arena_new_node(stp_mxml_arena_t *arena,
+						  stp_mxml_node_t *parent,
+						  stp_mxml_type_t type);
+
+#endif /* !GUTENPRINT_MXML_INTERNAL_H */
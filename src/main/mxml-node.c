@@ -24,6 +24,11 @@
  *   stp_mxmlNewDimension()    - Create a new dimension node.
  *   stp_mxmlNewText()    - Create a new text fragment node.
  *   stp_mxmlRemove()     - Remove a node from its parent.
+ *   stpi_mxml_arena_create()   - Create an arena for a document.
+ *   stpi_mxml_arena_destroy()  - Free an arena and everything in it.
+ *   stpi_mxml_arena_alloc()    - Allocate memory from an arena.
+ *   stpi_mxml_arena_strndup()  - Copy a string into an arena.
+ *   stpi_mxml_arena_new_node() - Create a new node in an arena.
  *   mxml_new()       - Create a new node.
  */
 
@@ -35,6 +40,10 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#include "mxml-internal.h"
+
+#define MXML_ARENA_MIN_BLOCK (4096)
+#define MXML_ARENA_MAX_BLOCK (1024 * 1024)
 
 
 /*
@@ -193,6 +202,18 @@ stp_mxmlDelete(stp_mxml_node_t *node)		/* I - Node to delete */
   while (node->child)
     stp_mxmlDelete(node->child);
 
+ /*
+  * Nodes in an arena are freed all at once, along with the top node...
+  */
+
+  if (node->arena)
+  {
+    if (node->arena->top == node)
+      stpi_mxml_arena_destroy(node->arena);
+
+    return;
+  }
+
  /*
   * Now delete any node data...
   */
@@ -470,6 +491,166 @@ stp_mxmlRemove(stp_mxml_node_t *node)		/* I - Node to remove */
 }
 
 
+/*
+ * Arena blocks are chained through their first word; the union keeps
+ * the memory that follows aligned for any node or attribute array.
+ */
+
+typedef union mxml_block_u
+{
+  union mxml_block_u	*next;			/* Next (older) block */
+  double		align;			/* Alignment */
+  void			*ptr;			/* Alignment */
+} mxml_block_t;
+
+
+/*
+ * 'stpi_mxml_arena_create()' - Create an arena for a document.
+ */
+
+stp_mxml_arena_t *			/* O - New arena or NULL */
+stpi_mxml_arena_create(void)
+{
+  stp_mxml_arena_t	*arena;			/* New arena */
+
+
+  if ((arena = calloc(1, sizeof(stp_mxml_arena_t))) == NULL)
+    return (NULL);
+
+  arena->block_size = MXML_ARENA_MIN_BLOCK;
+
+  return (arena);
+}
+
+
+/*
+ * 'stpi_mxml_arena_destroy()' - Free an arena and everything in it.
+ */
+
+void
+stpi_mxml_arena_destroy(stp_mxml_arena_t *arena)	/* I - Arena */
+{
+  mxml_block_t	*block,			/* Current block */
+		*next;			/* Next block */
+
+
+  if (!arena)
+    return;
+
+  for (block = arena->blocks; block; block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+
+  free(arena);
+}
+
+
+/*
+ * 'stpi_mxml_arena_alloc()' - Allocate memory from an arena.
+ *
+ * Blocks start small so that short strings don't cost much, and double
+ * in size as a document grows.  A request too big for the block size
+ * gets a block of its own.
+ */
+
+void *					/* O - Memory or NULL */
+stpi_mxml_arena_alloc(stp_mxml_arena_t *arena,	/* I - Arena */
+                      size_t           size)	/* I - Bytes wanted */
+{
+  mxml_block_t	*block;			/* New block */
+  size_t	bytes;			/* Size of new block */
+  void		*ptr;			/* Memory to return */
+
+
+  size = (size + sizeof(mxml_block_t) - 1) / sizeof(mxml_block_t) *
+         sizeof(mxml_block_t);
+
+  if (size > arena->left)
+  {
+    bytes = size > arena->block_size ? size : arena->block_size;
+
+    if ((block = malloc(sizeof(mxml_block_t) + bytes)) == NULL)
+      return (NULL);
+
+    if (bytes > arena->block_size && arena->blocks)
+    {
+     /*
+      * Leave the current block in use...
+      */
+
+      block->next = ((mxml_block_t *)arena->blocks)->next;
+      ((mxml_block_t *)arena->blocks)->next = block;
+
+      return (block + 1);
+    }
+
+    block->next   = arena->blocks;
+    arena->blocks = block;
+    arena->next   = (char *)(block + 1);
+    arena->left   = bytes;
+
+    if (arena->block_size < MXML_ARENA_MAX_BLOCK)
+      arena->block_size *= 2;
+  }
+
+  ptr          = arena->next;
+  arena->next += size;
+  arena->left -= size;
+
+  return (ptr);
+}
+
+
+/*
+ * 'stpi_mxml_arena_strndup()' - Copy a string into an arena.
+ */
+
+char *					/* O - Copy of string or NULL */
+stpi_mxml_arena_strndup(stp_mxml_arena_t *arena,	/* I - Arena */
+                        const char       *s,		/* I - String */
+			size_t           len)		/* I - Length of string */
+{
+  char	*copy;				/* Copy of string */
+
+
+  if ((copy = stpi_mxml_arena_alloc(arena, len + 1)) != NULL)
+  {
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+  }
+
+  return (copy);
+}
+
+
+/*
+ * 'stpi_mxml_arena_new_node()' - Create a new node in an arena.
+ */
+
+stp_mxml_node_t *			/* O - New node */
+stpi_mxml_arena_new_node(stp_mxml_arena_t *arena,	/* I - Arena */
+                         stp_mxml_node_t  *parent,	/* I - Parent node */
+                         stp_mxml_type_t  type)		/* I - Node type */
+{
+  stp_mxml_node_t	*node;			/* New node */
+
+
+  if ((node = stpi_mxml_arena_alloc(arena, sizeof(stp_mxml_node_t))) == NULL)
+    return (NULL);
+
+  memset(node, 0, sizeof(stp_mxml_node_t));
+  node->type  = type;
+  node->arena = arena;
+
+  if (parent)
+    stp_mxmlAdd(parent, STP_MXML_ADD_AFTER, STP_MXML_ADD_TO_PARENT, node);
+
+  return (node);
+}
+
+
 /*
  * 'mxml_new()' - Create a new node.
  */
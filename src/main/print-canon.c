@@ -65,6 +65,14 @@
 #  define MAX(a, b) ((a) > (b) ? (a) : (b))
 #endif /* !MAX */
 
+/*
+ * The packers below read overlapping 16 bit windows of the folded raster
+ * and look the pixel combination up in a table.  The windows repeat every
+ * few input bytes, so whole groups are done with fixed shifts and only
+ * the last partial group goes through the general loop.  Output is
+ * written behind the read position, so packing works in place.
+ */
+
 /* 5 3-level pixels into 1 byte */
 static int
 pack_pixels(unsigned char* buf,int len)
@@ -72,6 +80,21 @@ pack_pixels(unsigned char* buf,int len)
   int read_pos = 0;
   int write_pos = 0;
   int shift = 6;
+  /* 4 output bytes for every 5 input bytes */
+  while(read_pos + 4 < len)
+  {
+    unsigned b0 = buf[read_pos];
+    unsigned b1 = buf[read_pos + 1];
+    unsigned b2 = buf[read_pos + 2];
+    unsigned b3 = buf[read_pos + 3];
+    unsigned b4 = buf[read_pos + 4];
+    buf[write_pos] = tentoeight[((b0 << 8 | b1) >> 6) & 1023];
+    buf[write_pos + 1] = tentoeight[((b1 << 8 | b2) >> 4) & 1023];
+    buf[write_pos + 2] = tentoeight[((b2 << 8 | b3) >> 2) & 1023];
+    buf[write_pos + 3] = tentoeight[(b3 << 8 | b4) & 1023];
+    write_pos += 4;
+    read_pos += 5;
+  }
   while(read_pos < len)
   {
     /* read 5pixels at 2 bit */
@@ -97,68 +120,48 @@ pack_pixels(unsigned char* buf,int len)
   return write_pos;
 }
 
-/* 3 4-bit-per-pixel  5-level pixels into 1 byte */
+/* 3 4-bit-per-pixel pixels into 1 byte, using the given table */
 static int
-pack_pixels3_5(unsigned char* buf,int len)
+pack_pixels3(unsigned char* buf,int len,const unsigned char *table)
 {
   int read_pos = 0;
   int write_pos = 0;
-  int shift = 4;
-  while(read_pos < len)
+  /* 2 output bytes for every 3 input bytes */
+  while(read_pos + 2 < len)
+  {
+    unsigned b0 = buf[read_pos];
+    unsigned b1 = buf[read_pos + 1];
+    unsigned b2 = buf[read_pos + 2];
+    buf[write_pos] = table[((b0 << 8 | b1) >> 4) & 4095];
+    buf[write_pos + 1] = table[(b1 << 8 | b2) & 4095];
+    write_pos += 2;
+    read_pos += 3;
+  }
+  /* at most 2 bytes left, both read with a shift of 4 */
+  if(read_pos < len)
   {
-    /* read 3pixels at 4 bit */
     unsigned short value = buf[read_pos] << 8;
     if(read_pos+1 < len)
       value += buf[read_pos + 1];
-    if(shift)       /*4,0*/
-      value >>= shift;
-    /* write 8bit value representing the 12 bit pixel combination */
-    buf[write_pos] = twelve2eight[value & 4095];
-    ++write_pos;
-    if(shift == 0)
-    {
-      shift = 4;
-      read_pos += 2;
-    }
-    else
-    {
-      shift -= 4;
-      ++read_pos;
-    }
+    buf[write_pos++] = table[(value >> 4) & 4095];
+    if(read_pos+1 < len)
+      buf[write_pos++] = table[(buf[read_pos + 1] << 8) & 4095];
   }
   return write_pos;
 }
 
+/* 3 4-bit-per-pixel  5-level pixels into 1 byte */
+static int
+pack_pixels3_5(unsigned char* buf,int len)
+{
+  return pack_pixels3(buf, len, twelve2eight);
+}
+
 /* 3 4-bit-per-pixel 6-level pixels into 1 byte */
 static int
 pack_pixels3_6(unsigned char* buf,int len)
 {
-  int read_pos = 0;
-  int write_pos = 0;
-  int shift = 4;
-  while(read_pos < len)
-  {
-    /* read 3pixels at 4 bit */
-    unsigned short value = buf[read_pos] << 8;
-    if(read_pos+1 < len)
-      value += buf[read_pos + 1];
-    if(shift)       /*4,0*/
-      value >>= shift;
-    /* write 8bit value representing the 12 bit pixel combination */
-    buf[write_pos] = twelve2eight2[value & 4095];
-    ++write_pos;
-    if(shift == 0)
-    {
-      shift = 4;
-      read_pos += 2;
-    }
-    else
-    {
-      shift -= 4;
-      ++read_pos;
-    }
-  }
-  return write_pos;
+  return pack_pixels3(buf, len, twelve2eight2);
 }
 
 /* model peculiarities */
@@ -230,6 +233,9 @@ typedef struct
   const canon_cap_t *caps;
   unsigned char *comp_buf;
   unsigned char *fold_buf;
+  unsigned char *line_buf; /* commands and data of the current line */
+  int line_buf_used;
+  int write_order[8]; /* channel for each of "KYMCymck", or -1 */
   int delay_max;
   int buf_length_max;
   int length;
@@ -274,6 +280,7 @@ static const char* find_ink_type(stp_vars_t *v,const canon_mode_t* mode,const ch
 static const canon_mode_t* canon_check_current_mode(stp_vars_t *v);
 
 static void canon_write_line(stp_vars_t *v);
+static void canon_setup_write_order(canon_privdata_t *pd);
 
 static void canon_advance_paper(stp_vars_t *, int);
 static void canon_flush_pass(stp_vars_t *, int, int);
@@ -6137,6 +6144,10 @@ canon_do_print(stp_vars_t *v, stp_image_t *image)
       privdata.comp_buf = stp_zalloc(stp_compute_tiff_linewidth(v, privdata.buf_length_max * 2));
   /* Allocate fold buffer */
   privdata.fold_buf = stp_zalloc(stp_compute_tiff_linewidth(v, privdata.buf_length_max));
+  /* Allocate line buffer: up to 8 colors with their headers, plus the end of line */
+  privdata.line_buf = stp_malloc(8 * (stp_compute_tiff_linewidth(v, privdata.buf_length_max * 2) + 16) + 8);
+  privdata.line_buf_used = 0;
+  canon_setup_write_order(&privdata);
 
 
 
@@ -6386,6 +6397,7 @@ canon_do_print(stp_vars_t *v, stp_image_t *image)
 
   stp_free(privdata.fold_buf);
   stp_free(privdata.comp_buf);
+  stp_free(privdata.line_buf);
 
   if(cd_mask)
       stp_free(cd_mask);
@@ -6443,17 +6455,17 @@ static const stp_printfuncs_t print_canon_printfuncs =
 static void
 canon_shift_buffer(unsigned char *line,int length,int bits)
 {
-  int i,j;
-  for (j=0; j<bits; j++) {
-    for (i=length-1; i>0; i--) {
-      line[i]= (line[i] >> 1) | (line[i-1] << 7);
-    }
-    line[0] = line[0] >> 1;
+  int i;
+  /* bits is 1..7, so shift the whole amount in one pass */
+  for (i=length-1; i>0; i--) {
+    line[i]= (line[i] >> bits) | (line[i-1] << (8 - bits));
   }
+  line[0] = line[0] >> bits;
 }
 
 
-/* fold, apply the necessary compression, pack tiff and return the compressed length */
+/* fold, apply the necessary compression, pack tiff and return the compressed length;
+   canon_write() and canon_write_multiraster() both pack their lines here */
 static int canon_compress(stp_vars_t *v, canon_privdata_t *pd, unsigned char* line,int length,int offset,unsigned char* comp_buf,int bits, int ink_flags)
 {
   unsigned char
@@ -6582,62 +6594,99 @@ canon_write(stp_vars_t *v,		/* I - Print file or command */
 {
 
   unsigned char color;
+  unsigned char *out;
   int newlength = canon_compress(v,pd,line,length,offset,pd->comp_buf,bits,ink_flags);
   if(!newlength)
       return 0;
+  out = pd->line_buf + pd->line_buf_used;
   /* send packed empty lines if any */
 
   if (*empty) {
-    stp_zfwrite("\033\050\145\002\000", 5, 1, v);
-    stp_put16_be(*empty, v);
+    memcpy(out, "\033\050\145\002\000", 5);
+    out[5] = (*empty >> 8) & 0xff;
+    out[6] = *empty & 0xff;
+    out += 7;
     *empty= 0;
   }
 
  /* Send a line of raster graphics... */
 
-  stp_zfwrite("\033\050\101", 3, 1, v);
-  stp_put16_le(newlength + 1, v);
+  memcpy(out, "\033\050\101", 3);
+  out[3] = (newlength + 1) & 0xff;
+  out[4] = ((newlength + 1) >> 8) & 0xff;
   color= "CMYKcmyk"[coloridx];
   if (!color) color= 'K';
-  stp_putc(color,v);
-  stp_zfwrite((const char *)pd->comp_buf, newlength, 1, v);
-  stp_putc('\015', v);
+  out[5] = color;
+  memcpy(out + 6, pd->comp_buf, newlength);
+  out[6 + newlength] = '\015';
+  out += 7 + newlength;
+  pd->line_buf_used = out - pd->line_buf;
   return 1;
 }
 
+/*
+ * Send everything canon_write() has collected for the current line.
+ */
+
+static void
+canon_flush_line(stp_vars_t *v, canon_privdata_t *pd)
+{
+  if (pd->line_buf_used)
+    stp_zfwrite((const char *)pd->line_buf, pd->line_buf_used, 1, v);
+  pd->line_buf_used = 0;
+}
+
+/*
+ * Look up the channel for each color in the order canon_write_line()
+ * sends them, so that doesn't have to be done for every line.
+ */
+
+static void
+canon_setup_write_order(canon_privdata_t *pd)
+{
+  static const char write_sequence[] = "KYMCymck";
+  int i, x;
+  for (i = 0; i < 8; i++)
+    {
+      pd->write_order[i] = -1;
+      for (x = 0; x < pd->num_channels; x++)
+	if (pd->channels[x].name == write_sequence[i])
+	  {
+	    pd->write_order[i] = x;
+	    break;
+	  }
+    }
+}
+
 
 static void
 canon_write_line(stp_vars_t *v)
 {
   canon_privdata_t *pd =
     (canon_privdata_t *) stp_get_component_data(v, "Driver");
-  char write_sequence[] = "KYMCymck";
   static const int write_number[] = { 3, 2, 1, 0, 6, 5, 4, 7 };   /* KYMCymc */
   int i;
   int written= 0;
-  for (i = 0; i < strlen(write_sequence) ; i++)
+  for (i = 0; i < 8 ; i++)
     {
-      int x;
-      const canon_channel_t* channel=NULL;
+      const canon_channel_t* channel;
       int num = write_number[i];
 
-      /* TODO optimize => move reorder code to do_print */
-      for(x=0;x < pd->num_channels; x++){
-	if(pd->channels[x].name == write_sequence[i]){
-              channel = &(pd->channels[x]);
-              break;
-          }
-      }
-      if(channel){
-        written += canon_write(v, pd, pd->caps,
-                               channel->buf + channel->delay * pd->length /*buf_length[i]*/,
-                               pd->length, num,
-                               &(pd->emptylines), pd->out_width,
-                               pd->left, channel->props->bits, channel->props->flags);
-      }
+      if (pd->write_order[i] < 0)
+        continue;
+      channel = &(pd->channels[pd->write_order[i]]);
+      written += canon_write(v, pd, pd->caps,
+                             channel->buf + channel->delay * pd->length /*buf_length[i]*/,
+                             pd->length, num,
+                             &(pd->emptylines), pd->out_width,
+                             pd->left, channel->props->bits, channel->props->flags);
     }
   if (written)
-    stp_zfwrite("\033\050\145\002\000\000\001", 7, 1, v);
+    {
+      memcpy(pd->line_buf + pd->line_buf_used, "\033\050\145\002\000\000\001", 7);
+      pd->line_buf_used += 7;
+      canon_flush_line(v, pd);
+    }
   else
     pd->emptylines += 1;
 }
@@ -6755,6 +6804,7 @@ canon_flush_pass(stp_vars_t *v, int passno, int vertical_subpass)
 */
                   if ( pass->logicalpassstart - pd->last_pass_offset > 0 )
                     {
+                      canon_flush_line(v, pd);
                       canon_advance_paper(v, papershift);
                       pd->last_pass_offset = pass->logicalpassstart;
                       if (pd->bidirectional)
@@ -6776,6 +6826,7 @@ canon_flush_pass(stp_vars_t *v, int passno, int vertical_subpass)
             }
         }
 
+      canon_flush_line(v, pd);
       if ( written == 0 ) /* count unused nozzles */
         (pd->emptylines) += 1;
     }
@@ -751,25 +751,46 @@ initialize_channels(stp_vars_t *v, stp_image_t *image)
   lut->channels_are_initialized = 1;
 }
 
+/*
+ * Identical adjacent rows (flat fills, borders, blank space in scans)
+ * are common, so the last row read is kept, and if the next one is the
+ * same the conversion and channel processing are skipped: the channel
+ * buffers still hold the result.  This relies on nobody writing into
+ * the channel buffers between rows.
+ */
 static int
 stpi_color_traditional_get_row(stp_vars_t *v,
 			       stp_image_t *image,
 			       int row,
 			       unsigned *zero_mask)
 {
-  const lut_t *lut = (const lut_t *)(stp_get_component_data(v, "Color"));
+  lut_t *lut = (lut_t *)(stp_get_component_data(v, "Color"));
+  size_t row_bytes =
+    lut->image_width * lut->in_channels * lut->channel_depth / 8;
+  unsigned char *tmp;
   unsigned zero;
-  if (stp_image_get_row(image, lut->in_data,
-			lut->image_width * lut->in_channels * lut->channel_depth / 8, row)
+  if (stp_image_get_row(image, lut->next_in_data, row_bytes, row)
       != STP_IMAGE_STATUS_OK)
     return 2;
+  if (lut->row_is_converted &&
+      memcmp(lut->next_in_data, lut->in_data, row_bytes) == 0)
+    {
+      if (zero_mask)
+	*zero_mask = lut->row_zero_mask;
+      return 0;
+    }
+  tmp = lut->in_data;
+  lut->in_data = lut->next_in_data;
+  lut->next_in_data = tmp;
   if (!lut->channels_are_initialized)
     initialize_channels(v, image);
   zero = (lut->output_color_description->conversion_function)
     (v, lut->in_data, stp_channel_get_input(v));
+  stp_channel_convert(v, &zero);
+  lut->row_zero_mask = zero;
+  lut->row_is_converted = 1;
   if (zero_mask)
     *zero_mask = zero;
-  stp_channel_convert(v, zero_mask);
   return 0;
 }
 
@@ -844,8 +865,10 @@ copy_lut(void *vlut)
   /* Don't copy cmy_tmp */
   if (src->in_data)
     {
-      dest->in_data = stp_malloc(src->image_width * src->in_channels);
-      memset(dest->in_data, 0, src->image_width * src->in_channels);
+      size_t row_bytes =
+	((src->image_width * src->in_channels * src->channel_depth) + 7) / 8;
+      dest->in_data = stp_zalloc(row_bytes);
+      dest->next_in_data = stp_zalloc(row_bytes);
     }
   return dest;
 }
@@ -864,6 +887,7 @@ free_lut(void *vlut)
   STP_SAFE_FREE(lut->gray_tmp);
   STP_SAFE_FREE(lut->cmy_tmp);
   STP_SAFE_FREE(lut->in_data);
+  STP_SAFE_FREE(lut->next_in_data);
   memset(lut, 0, sizeof(lut_t));
   stp_free(lut);
 }
@@ -1010,8 +1034,49 @@ channel_is_synthesized(lut_t *lut, int channel)
     return 0;			/* Case 6 */
 }
 
+/*
+ * Finished curves are kept in a process-wide refcache, keyed by a
+ * canonical string of everything that went into computing them, so that
+ * later pages and jobs with the same settings copy the result instead of
+ * redoing the pow() and resampling work.  The oldest entry is dropped
+ * once the cache is full.
+ */
+#define LUT_CACHE "colorLUT"
+#define LUT_CACHE_MAX 64
+
+static int
+lut_cache_get(const char *key, stp_cached_curve_t *cache)
+{
+  const stp_curve_t *curve =
+    (const stp_curve_t *) stp_refcache_find_item(LUT_CACHE, key);
+  if (!curve)
+    return 0;
+  stp_curve_free_curve_cache(cache);
+  stp_curve_cache_set_curve_copy(cache, curve);
+  return 1;
+}
+
 static void
-compute_user_correction(lut_t *lut)
+lut_cache_put(const char *key, stp_cached_curve_t *cache)
+{
+  const stp_string_list_t *items;
+  stp_curve_t *curve = stp_curve_cache_get_curve(cache);
+  if (!curve || stp_refcache_find_item(LUT_CACHE, key))
+    return;
+  items = stp_refcache_list_cache_items(LUT_CACHE);
+  if (items && stp_string_list_count(items) >= LUT_CACHE_MAX)
+    {
+      char *oldest = stp_strdup(stp_string_list_param(items, 0)->name);
+      stp_curve_destroy((stp_curve_t *)
+			stp_refcache_find_item(LUT_CACHE, oldest));
+      stp_refcache_remove_item(LUT_CACHE, oldest);
+      stp_free(oldest);
+    }
+  stp_refcache_add_item(LUT_CACHE, key, stp_curve_create_copy(curve));
+}
+
+static void
+do_compute_user_correction(lut_t *lut)
 {
   double *tmp;
   double *tmp_brightness;
@@ -1111,6 +1176,30 @@ compute_user_correction(lut_t *lut)
   stp_free(tmp_contrast);
 }
 
+static void
+compute_user_correction(lut_t *lut)
+{
+  char *key;
+  char *bkey;
+  char *ckey;
+  stp_asprintf(&key, "user %u %d %.17g %.17g", lut->steps,
+	       lut->linear_contrast_adjustment, lut->contrast, lut->brightness);
+  stp_asprintf(&bkey, "%s brightness", key);
+  stp_asprintf(&ckey, "%s contrast", key);
+  if (!lut_cache_get(key, &(lut->user_color_correction)) ||
+      !lut_cache_get(bkey, &(lut->brightness_correction)) ||
+      !lut_cache_get(ckey, &(lut->contrast_correction)))
+    {
+      do_compute_user_correction(lut);
+      lut_cache_put(key, &(lut->user_color_correction));
+      lut_cache_put(bkey, &(lut->brightness_correction));
+      lut_cache_put(ckey, &(lut->contrast_correction));
+    }
+  stp_free(key);
+  stp_free(bkey);
+  stp_free(ckey);
+}
+
 static void
 compute_a_curve_full(lut_t *lut, int channel)
 {
@@ -1279,10 +1368,20 @@ compute_one_lut(lut_t *lut, int i)
 {
   stp_curve_t *curve =
     stp_curve_cache_get_curve(&(lut->channel_curves[i]));
+  char *key;
   if (curve)
     {
       int invert_output =
 	!channel_is_synthesized(lut, i) && lut->invert_output;
+      char *curve_string = stp_curve_write_string(curve);
+      stp_asprintf(&key, "curve %u %d %d %s", lut->steps, lut->invert_output,
+		   invert_output, curve_string);
+      stp_free(curve_string);
+      if (lut_cache_get(key, &(lut->channel_curves[i])))
+	{
+	  stp_free(key);
+	  return;
+	}
       stp_curve_rescale(curve, 65535.0, STP_CURVE_COMPOSE_MULTIPLY,
 			STP_CURVE_BOUNDS_RESCALE);
       if (stp_curve_is_piecewise(curve))
@@ -1293,12 +1392,24 @@ compute_one_lut(lut_t *lut, int i)
     }
   else
     {
+      stp_asprintf(&key, "gamma %u %d %s %s %d %.17g %.17g %.17g",
+		   lut->steps, i, lut->input_color_description->name,
+		   lut->output_color_description->name,
+		   lut->simple_gamma_correction, lut->gamma_values[i],
+		   lut->screen_gamma, lut->print_gamma);
+      if (lut_cache_get(key, &(lut->channel_curves[i])))
+	{
+	  stp_free(key);
+	  return;
+	}
       curve = stp_curve_create_copy(color_curve_bounds);
       stp_curve_rescale(curve, 65535.0, STP_CURVE_COMPOSE_MULTIPLY,
 			STP_CURVE_BOUNDS_RESCALE);
       stp_curve_cache_set_curve(&(lut->channel_curves[i]), curve);
       compute_a_curve(lut, i);
     }
+  lut_cache_put(key, &(lut->channel_curves[i]));
+  stp_free(key);
 }
 
 static void
@@ -1578,8 +1689,10 @@ stpi_color_traditional_init(stp_vars_t *v,
 
   lut->image_width = stp_image_width(image);
   total_channel_bits = lut->in_channels * lut->channel_depth;
-  lut->in_data = stp_malloc(((lut->image_width * total_channel_bits) + 7)/8);
-  memset(lut->in_data, 0, ((lut->image_width * total_channel_bits) + 7) / 8);
+  lut->in_data = stp_zalloc(((lut->image_width * total_channel_bits) + 7)/8);
+  lut->next_in_data =
+    stp_zalloc(((lut->image_width * total_channel_bits) + 7) / 8);
+  lut->row_is_converted = 0;
   return lut->out_channels;
 }
 
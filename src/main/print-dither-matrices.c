@@ -452,6 +452,7 @@ typedef struct
   int y;
   const char *filename;
   const stp_array_t *dither_array;
+  stp_dither_matrix_impl_t matrix[2]; /* Built from dither_array, by transpose */
 } stp_xml_dither_cache_t;
 
 static stp_xml_dither_cache_t *
@@ -507,6 +508,7 @@ stp_xml_dither_cache_set(int x, int y, const char *filename)
   cacheval->y = y;
   cacheval->filename = stp_strdup(filename);
   cacheval->dither_array = NULL;
+  memset(cacheval->matrix, 0, sizeof(cacheval->matrix));
 
   stp_list_item_create(dither_matrix_cache, NULL, (void *) cacheval);
 
@@ -647,16 +649,79 @@ stpi_dither_array_create_from_file(const char* file, int x, int y)
   return ret;
 }
 
+/*
+ * The standard matrices are compiled in (see gen-dither-matrices.c), so
+ * the usual aspect ratios never need their XML parsed.  Anything else
+ * still comes from the XML files.
+ */
+typedef struct
+{
+  int x_aspect;
+  int y_aspect;
+  int x_size;
+  int y_size;
+  const unsigned short *data;
+} stpi_builtin_dither_matrix_t;
+
+#include "dither-matrices-builtin.h"
+
+static const int builtin_dither_matrix_count =
+  sizeof(builtin_dither_matrices) / sizeof(stpi_builtin_dither_matrix_t);
+
 static stp_array_t *
-stp_xml_get_dither_array(int x, int y)
+create_builtin_dither_array(int x, int y)
+{
+  int i, j;
+  for (i = 0; i < builtin_dither_matrix_count; i++)
+    {
+      const stpi_builtin_dither_matrix_t *m = &(builtin_dither_matrices[i]);
+      if (m->x_aspect == x && m->y_aspect == y)
+	{
+	  int count = m->x_size * m->y_size;
+	  stp_array_t *ret = stp_array_create(m->x_size, m->y_size);
+	  double *tmp = stp_malloc(sizeof(double) * count);
+	  for (j = 0; j < count; j++)
+	    tmp[j] = m->data[j];
+	  stp_sequence_set_bounds
+	    (stpi_cast_safe(stp_array_get_sequence(ret)),
+	     0, 65535);
+	  stp_array_set_data(ret, tmp);
+	  stp_free(tmp);
+	  stp_deprintf(STP_DBG_XML,
+		       "create_builtin_dither_array: using built in %dx%d\n",
+		       x, y);
+	  return ret;
+	}
+    }
+  return NULL;
+}
+
+static stp_xml_dither_cache_t *
+stp_xml_load_dither_array(int x, int y)
 {
   stp_xml_dither_cache_t *cachedval;
-  stp_array_t *ret;
+  stp_array_t *builtin;
 
   cachedval = stp_xml_dither_cache_get(x, y);
 
   if (cachedval && cachedval->dither_array)
-    return stp_array_create_copy(cachedval->dither_array);
+    return cachedval;
+
+  builtin = create_builtin_dither_array(x, y);
+  if (builtin)
+    {
+      if (!cachedval)
+	{
+	  if (dither_matrix_cache == NULL)
+	    dither_matrix_cache = stp_list_create();
+	  cachedval = stp_zalloc(sizeof(stp_xml_dither_cache_t));
+	  cachedval->x = x;
+	  cachedval->y = y;
+	  stp_list_item_create(dither_matrix_cache, NULL, (void *) cachedval);
+	}
+      cachedval->dither_array = builtin;
+      return cachedval;
+    }
 
   if (!cachedval)
     {
@@ -670,10 +735,9 @@ stp_xml_get_dither_array(int x, int y)
 	}
     }
 
-  ret = stpi_dither_array_create_from_file(cachedval->filename, x, y);
-
-  cachedval->dither_array = ret;
-  return stp_array_create_copy(ret);
+  cachedval->dither_array =
+    stpi_dither_array_create_from_file(cachedval->filename, x, y);
+  return cachedval->dither_array ? cachedval : NULL;
 }
 
 void
@@ -682,10 +746,10 @@ stpi_init_dither(void)
   stp_register_xml_parser("dither-matrix", stp_xml_process_dither_matrix);
 }
 
-stp_array_t *
-stp_find_standard_dither_array(int x_aspect, int y_aspect)
+static stp_xml_dither_cache_t *
+find_standard_dither_cache(int x_aspect, int y_aspect)
 {
-  stp_array_t *answer;
+  stp_xml_dither_cache_t *answer;
   int divisor = gcd(x_aspect, y_aspect);
 
   x_aspect /= divisor;
@@ -700,11 +764,47 @@ stp_find_standard_dither_array(int x_aspect, int y_aspect)
   x_aspect /= divisor;
   y_aspect /= divisor;
 
-  answer = stp_xml_get_dither_array(x_aspect, y_aspect);
+  answer = stp_xml_load_dither_array(x_aspect, y_aspect);
   if (answer)
     return answer;
-  answer = stp_xml_get_dither_array(y_aspect, x_aspect);
+  answer = stp_xml_load_dither_array(y_aspect, x_aspect);
   if (answer)
     return answer;
   return NULL;
 }
+
+stp_array_t *
+stp_find_standard_dither_array(int x_aspect, int y_aspect)
+{
+  stp_xml_dither_cache_t *answer =
+    find_standard_dither_cache(x_aspect, y_aspect);
+  if (answer)
+    return stp_array_create_copy(answer->dither_array);
+  return NULL;
+}
+
+/*
+ * Use the standard matrix for this aspect ratio.  The matrix built from
+ * the array is kept with the cached array and shared read-only, so later
+ * pages (and later jobs in the same process) don't rebuild it.
+ */
+int
+stpi_dither_set_standard_matrix(stp_vars_t *v, int x_aspect, int y_aspect,
+				int transpose)
+{
+  stpi_dither_t *d = (stpi_dither_t *) stp_get_component_data(v, "Dither");
+  stp_xml_dither_cache_t *cachedval =
+    find_standard_dither_cache(x_aspect, y_aspect);
+  stp_dither_matrix_impl_t *mat;
+
+  if (!cachedval)
+    return 0;
+  mat = &(cachedval->matrix[transpose ? 1 : 0]);
+  if (!mat->matrix)
+    stp_dither_matrix_init_from_dither_array(mat, cachedval->dither_array,
+					     transpose);
+  preinit_matrix(v);
+  stp_dither_matrix_clone(mat, &(d->dither_matrix), 0, 0);
+  postinit_matrix(v, 0, 0);
+  return 1;
+}
@@ -788,6 +788,8 @@ typedef struct lexm_privdata_weave {
   int ncolors;
   int horizontal_weave;
   unsigned char *outbuf;
+  unsigned char *colbuf;	/* pass bitmaps turned into nozzle columns */
+  int colbuf_size;
 } lexm_privdata_weave;
 
 
@@ -1898,6 +1900,8 @@ densityDivisor /= 1.2;
   privdata.bidirectional = lexmark_print_bidirectional(v, model, resolution);
   privdata.outbuf = stp_malloc((((((pass_length/8)*11))+40) * out_width)+2000);
   privdata.direction = 0;
+  privdata.colbuf = NULL;
+  privdata.colbuf_size = 0;
   stp_allocate_component_data(v, "Driver", NULL, NULL, &privdata);
   /*  lxm_nozzles_used = 1;*/
 
@@ -2147,6 +2151,7 @@ densityDivisor /= 1.2;
   if (privdata.outbuf != NULL) {
     stp_free(privdata.outbuf);/* !!!!!!!!!!!!!! */
   }
+  STP_SAFE_FREE(privdata.colbuf);
 
   for (i = 0; i < NCHANNELS; i++)
     if (cols.v[i])
@@ -2400,6 +2405,97 @@ typedef struct Lexmark_head_colors {
   int used_jets;
 } Lexmark_head_colors;
 
+/* abcdefgh -> 0a0b0c0d0e0f0g0h */
+static inline unsigned
+lexmark_spread_bits(unsigned bits)
+{
+  bits = (bits | (bits << 4)) & 0x0f0f;
+  bits = (bits | (bits << 2)) & 0x3333;
+  return (bits | (bits << 1)) & 0x5555;
+}
+
+/*
+ * Transpose a block of 8 bitmap rows (stride bytes apart, only the first
+ * rows of them used) into 8 column bytes, one per pixel, with the first
+ * row in the top bit.
+ */
+static inline void
+lexmark_transpose8(const unsigned char *in, int stride, int rows,
+		   unsigned char *out)
+{
+  unsigned long long x = 0;
+  unsigned long long t;
+  int i;
+
+  for (i = 0; i < 8; i++)
+    x = (x << 8) | (i < rows ? in[i * stride] : 0);
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+  for (i = 0; i < 8; i++)
+    out[i] = (unsigned char) (x >> (56 - 8 * i));
+}
+
+/*
+ * Turn the pass bitmaps of each head color into nozzle columns: for
+ * every group of 8 nozzles, one byte per pixel holding that pixel of
+ * the 8 even jet rows, followed by the same for the odd jet rows.  The
+ * even and odd jets of a nozzle are interleaved rows of the pass.  The
+ * head ranges are whole groups of 8 nozzles.
+ */
+static void
+lexmark_head_columns(const stp_vars_t *v, const Lexmark_head_colors *head_colors,
+		     const unsigned char **columns, int length)
+{
+  lexm_privdata_weave *pd =
+    (lexm_privdata_weave *) stp_get_component_data(v, "Driver");
+  int row_bytes = 8 * length;
+  int size = 0;
+  int c, parity, g, b;
+  unsigned char *out;
+
+  for (c = 0; c < 3; c++)
+    if (head_colors[c].line)
+      size += 2 * row_bytes * ((head_colors[c].head_nozzle_end -
+				head_colors[c].head_nozzle_start) / 8);
+  if (size > pd->colbuf_size)
+    {
+      STP_SAFE_FREE(pd->colbuf);
+      pd->colbuf = stp_malloc(size);
+      pd->colbuf_size = size;
+    }
+
+  out = pd->colbuf;
+  for (c = 0; c < 3; c++)
+    {
+      const Lexmark_head_colors *hc = &(head_colors[c]);
+      int groups = (hc->head_nozzle_end - hc->head_nozzle_start) / 8;
+      columns[c] = NULL;
+      if (!hc->line)
+	continue;
+      columns[c] = out;
+      for (parity = 0; parity < 2; parity++)
+	{
+	  /* the last odd jet is never used */
+	  int jets = hc->used_jets / 2 - parity;
+	  const unsigned char *in =
+	    hc->line + (hc->v_start * 2 + parity) * length;
+	  for (g = 0; g < groups; g++, out += row_bytes, in += 16 * length)
+	    {
+	      int rows = jets - g * 8;
+	      if (rows <= 0)
+		memset(out, 0, row_bytes);
+	      else
+		for (b = 0; b < length; b++)
+		  lexmark_transpose8(in + b, 2 * length, rows, out + 8 * b);
+	    }
+	}
+    }
+}
+
 /* lexmark_write
    This method is has NO printer type dependent code.
    This method writes a single line of the print. The line consists of "pass_length"
@@ -2428,10 +2524,10 @@ lexmark_write(const stp_vars_t *v,		/* I - Print file or command */
   unsigned char *tbits=NULL, *p=NULL;
   int clen;
   int x;  /* actual vertical position */
-  int y;  /* actual horizontal position */
-  int dy; /* horiz. inkjet position */
-  int x1;
+  int dy; /* group of 8 nozzles */
+  int x1; /* shift between even and odd jets */
   unsigned short pixelline;  /* byte to be written */
+  const unsigned char *columns[3];
   unsigned int valid_bytes; /* bit list which tells the present bytes */
   int xStart=0; /* count start for horizontal line */
   int xEnd=0;
@@ -2479,6 +2575,8 @@ lexmark_write(const stp_vars_t *v,		/* I - Print file or command */
 
   /* now we can start to write the pixels */
   yCount = 2;
+  x1 = get_lr_shift(mode);
+  lexmark_head_columns(v, head_colors, columns, length);
 
 
   for (x=xStart; x != xEnd; x+=xIter) {
@@ -2503,62 +2601,61 @@ lexmark_write(const stp_vars_t *v,		/* I - Print file or command */
 	}
 
 
-    pixelline =0;     /* here we store 16 pixels */
     valid_bytes = 0;  /* for every valid word (16 bits) a corresponding bit will be set to 1. */
 
-    anyDots =0;
-    x1 = x+get_lr_shift(mode);
-
+    /* the odd jets sit lr_shift pixels to the right of the even ones */
     for (colIndex=0; colIndex < 3; colIndex++) {
-      for (dy=head_colors[colIndex].head_nozzle_start,y=head_colors[colIndex].v_start*yCount;
-	   (dy < head_colors[colIndex].head_nozzle_end);
-	   y+=yCount, dy++) { /* we start counting with 1 !!!! */
-	if (head_colors[colIndex].line != NULL) {
-	  pixelline = pixelline << 1;
-	  if ((x >= 0) &&
-	      ((dy - head_colors[colIndex].head_nozzle_start) < (head_colors[colIndex].used_jets/2)))
-	    pixelline = pixelline | ((head_colors[colIndex].line[(y*length)+(x/8)] >> (7-(x%8))) & 0x1);
-	  pixelline = pixelline << 1;
-	  if ((x1 < width) &&
-	      (((dy - head_colors[colIndex].head_nozzle_start)+1) < (head_colors[colIndex].used_jets/2)))
-	    pixelline = pixelline | ((head_colors[colIndex].line[(((yCount>>1)+y)*length)+ (x1/8)] >> (7-(x1%8))) & 0x1);
-
-	} else {
-	  pixelline = pixelline << 2;
+      int groups = (head_colors[colIndex].head_nozzle_end -
+		    head_colors[colIndex].head_nozzle_start) / 8;
+      const unsigned char *even = columns[colIndex];
+      const unsigned char *odd = NULL;
+
+      /* a color this head doesn't print has no buffer at all */
+      if (even != NULL)
+	odd = even + groups * 8 * length;
+
+      for (dy = 0; dy < groups; dy++) {
+	unsigned even_bits = 0, odd_bits = 0;
+	if (even != NULL) {
+	  if (x >= 0)
+	    even_bits = even[x];
+	  if (x + x1 < width)
+	    odd_bits = odd[x + x1];
+	  even += 8 * length;
+	  odd += 8 * length;
 	}
+	/* 8 nozzles, even and odd jet of each in turn: 16 pixels */
+	pixelline = (lexmark_spread_bits(even_bits) << 1) |
+	  lexmark_spread_bits(odd_bits);
+
 	switch(caps->model)		{
 	case m_z52:
-	  if ((dy%8) == 7) {
-	    /* we have two bytes, write them */
-	    anyDots |= pixelline;
-	    if (pixelline) {
-	      /* we have some dots */
-	      valid_bytes = valid_bytes >> 1;
-	      *((p++)) = (unsigned char)(pixelline >> 8);
-	      *((p++)) = (unsigned char)(pixelline & 0xff);
-	    } else {
-	      /* there are no dots ! */
-	      valid_bytes = valid_bytes >> 1;
-	      valid_bytes |= 0x1000;
-	    }
-	    pixelline =0;
+	  /* we have two bytes, write them */
+	  anyDots |= pixelline;
+	  valid_bytes = valid_bytes >> 1;
+	  if (pixelline) {
+	    /* we have some dots */
+	    *((p++)) = (unsigned char)(pixelline >> 8);
+	    *((p++)) = (unsigned char)(pixelline & 0xff);
+	  } else {
+	    /* there are no dots ! */
+	    valid_bytes |= 0x1000;
 	  }
 	  break;
 
 	case m_3200:
 	case m_z42:
-	  if((dy % 4) == 3)
-	    {
-	      anyDots |= pixelline;
-	      valid_bytes <<= 1;
-
-	      if(pixelline)
-		*(p++) = (unsigned char)(pixelline & 0xff);
-	      else
-		valid_bytes |= 0x01;
-
-	      pixelline = 0;
-	    }
+	  /* one byte per 4 nozzles */
+	  anyDots |= pixelline;
+	  valid_bytes <<= 2;
+	  if (pixelline >> 8)
+	    *(p++) = (unsigned char)(pixelline >> 8);
+	  else
+	    valid_bytes |= 0x02;
+	  if (pixelline & 0xff)
+	    *(p++) = (unsigned char)(pixelline & 0xff);
+	  else
+	    valid_bytes |= 0x01;
 	  break;
 
 	case m_lex7500:
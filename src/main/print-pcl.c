@@ -48,6 +48,9 @@
  */
 static void	pcl_mode0(stp_vars_t *, unsigned char *, int, int);
 static void	pcl_mode2(stp_vars_t *, unsigned char *, int, int);
+static void	pcl_mode_delta(stp_vars_t *, unsigned char *, int, int);
+
+#define PCL_MAX_PLANES	16	/* Most planes in one raster row */
 
 #ifndef MAX
 #  define MAX(a, b) ((a) > (b) ? (a) : (b))
@@ -60,6 +63,13 @@ typedef struct
   unsigned char *row_buf;	/* For color laser */
   unsigned char *comp_buf;
   void (*writefunc)(stp_vars_t *, unsigned char *, int, int);	/* PCL output function */
+  unsigned char *seed_rows;	/* Last row of each plane, for delta row */
+  unsigned char *delta_buf;	/* Each plane's row in each candidate mode */
+  int delta_buf_size;		/* Space for one plane in one mode */
+  int delta_len[PCL_MAX_PLANES][3];
+  int delta_plane;		/* Next plane of the current row */
+  int delta_modes;		/* Number of pcl_delta_modes to try */
+  int comp_mode;		/* Compression mode last sent */
   int do_cret;
   int do_cretb;
   int do_6color;
@@ -346,6 +356,8 @@ typedef struct {
 #define PCL_PRINTER_LABEL       256     /* Datamax-O'Neil PCL Label Printer */
 #define PCL_PRINTER_LJ_COLOR	512	/* Color laser printers */
 #define PCL_PRINTER_COPIES     1024     /* Supports PCL5/HPGL2/HP-RTL copies */
+#define PCL_PRINTER_DELTAROW	2048	/* Delta row (mode 3) compression */
+#define PCL_PRINTER_MODE9	4096	/* Replacement delta row (mode 9) */
 
 /*
  * FIXME - the 520 shouldn't be lumped in with the 500 as it supports
@@ -924,7 +936,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {7, 41, 18, 18},
     {7, 41, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_DJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE,
+    PCL_PRINTER_DJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DELTAROW,
     dj500_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -937,7 +949,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {7, 33, 18, 18},
     {7, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMY,
-    PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE,
+    PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW,
     dj500_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -951,7 +964,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {7, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMY,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DELTAROW,
     dj540_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -964,7 +977,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {3, 33, 18, 18},
     {5, 33, 10, 10},
     PCL_COLOR_CMYK,
-    PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE,
+    PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW,
 /* The 550/560 support COM10 and DL envelope, but the control codes
    are negative, indicating landscape mode. This needs thinking about! */
     dj340_papersizes,
@@ -980,7 +994,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {0, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMY,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -994,7 +1009,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {0, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -1008,7 +1024,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {0, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK | PCL_COLOR_CMYKcm,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -1022,7 +1039,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {5, 33, 10, 10},
     PCL_COLOR_CMYK | PCL_COLOR_CMYK4,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -1036,7 +1054,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {0, 33, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK | PCL_COLOR_CMYK4b,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -1050,7 +1069,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {5, 33, 10, 10},	/* Oliver Vecernik */
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DUPLEX,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DUPLEX |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj600_papersizes,
     basic_papertypes,
     emptylist,
@@ -1064,7 +1084,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {5, 33, 10, 10},
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj1220_papersizes,
     basic_papertypes,
     emptylist,
@@ -1078,7 +1099,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {5, 33, 10, 10},
     PCL_COLOR_CMYK | PCL_COLOR_CMYK4,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE |
+      PCL_PRINTER_DELTAROW | PCL_PRINTER_MODE9,
     dj1100_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -1092,7 +1114,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMY,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     dj1200_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -1106,7 +1129,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     dj1200_papersizes,
     basic_papertypes,
     dj_papersources,
@@ -1120,7 +1144,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {0, 35, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DELTAROW,
     dj2000_papersizes,
     new_papertypes,
     dj_papersources,
@@ -1134,7 +1158,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_CMYK,
     PCL_PRINTER_DJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_MEDIATYPE |
-      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE,
+      PCL_PRINTER_CUSTOM_SIZE | PCL_PRINTER_BLANKLINE | PCL_PRINTER_DELTAROW,
     dj2500_papersizes,
     new_papertypes,
     dj2500_papersources,
@@ -1212,7 +1236,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1225,7 +1250,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1238,7 +1264,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1251,7 +1278,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1264,7 +1292,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1277,7 +1306,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljtabloid_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1290,7 +1320,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1303,7 +1334,8 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
-    PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES,
+    PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE | PCL_PRINTER_COPIES |
+      PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1317,7 +1349,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1331,7 +1363,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1345,7 +1377,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1359,7 +1391,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1373,7 +1405,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1387,7 +1419,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljtabloid_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1401,7 +1433,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_NONE,
     PCL_PRINTER_LJ | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1415,7 +1447,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1429,7 +1461,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 10, 10},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1443,7 +1475,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1457,7 +1489,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljbig_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1471,7 +1503,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_NEW_ERG | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljtabloid_papersizes,
     emptylist,
     laserjet_papersources,
@@ -1485,7 +1517,7 @@ static const pcl_cap_t pcl_model_capabilities[] =
     {12, 12, 18, 18},	/* Check/Fix */
     PCL_COLOR_RGB,
     PCL_PRINTER_LJ_COLOR | PCL_PRINTER_TIFF | PCL_PRINTER_BLANKLINE |
-      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES,
+      PCL_PRINTER_DUPLEX | PCL_PRINTER_COPIES | PCL_PRINTER_DELTAROW,
     ljsmall_papersizes,
     emptylist,
     laserjet_papersources,
@@ -2589,6 +2621,8 @@ pcl_printfunc(stp_vars_t *v)
 	      stp_dprintf(STP_DBG_PCL, v, "Blank Lines = %d\n", pd->blank_lines);
 	      stp_zprintf(v, "\033*b%dY", pd->blank_lines);
 	      pd->blank_lines=0;
+	      if (pd->seed_rows)		/* Y offset clears the seed rows */
+		memset(pd->seed_rows, 0, pd->height * PCL_MAX_PLANES);
 	    }
 	  else;
 	}
@@ -3339,7 +3373,27 @@ pcl_do_print(stp_vars_t *v, stp_image_t *image)
 
 /* Allocate buffer for pcl_mode2 tiff compression */
 
-  if ((caps->stp_printer_type & PCL_PRINTER_TIFF) == PCL_PRINTER_TIFF &&
+  if ((caps->stp_printer_type & (PCL_PRINTER_TIFF | PCL_PRINTER_DELTAROW)) ==
+      (PCL_PRINTER_TIFF | PCL_PRINTER_DELTAROW) &&
+      !(stp_get_debug_level() & STP_DBG_NO_COMPRESSION))
+  {
+    /*
+     * Delta row output; mode 2 stays selected until a row comes out
+     * smaller in mode 3 or 9.  The seed rows start out zeroed, as they
+     * do in the printer at the start of raster graphics.
+     */
+    privdata.comp_buf = NULL;
+    privdata.writefunc = pcl_mode_delta;
+    privdata.delta_buf_size = privdata.height * 2 + 16;
+    privdata.delta_buf =
+      stp_malloc(privdata.delta_buf_size * 3 * PCL_MAX_PLANES);
+    privdata.seed_rows = stp_zalloc(privdata.height * PCL_MAX_PLANES);
+    privdata.delta_plane = 0;
+    privdata.delta_modes =
+      (caps->stp_printer_type & PCL_PRINTER_MODE9) ? 3 : 2;
+    privdata.comp_mode = 2;
+  }
+  else if ((caps->stp_printer_type & PCL_PRINTER_TIFF) == PCL_PRINTER_TIFF &&
       !(stp_get_debug_level() & STP_DBG_NO_COMPRESSION))
   {
     privdata.comp_buf = stp_malloc((privdata.height + 128 + 7) * 129 / 128);
@@ -3624,6 +3678,8 @@ pcl_do_print(stp_vars_t *v, stp_image_t *image)
 
   if (privdata.comp_buf != NULL)
     stp_free(privdata.comp_buf);
+  STP_SAFE_FREE(privdata.delta_buf);
+  STP_SAFE_FREE(privdata.seed_rows);
   if (privdata.row_buf != NULL)
     stp_free(privdata.row_buf);
 
@@ -3714,6 +3770,201 @@ pcl_mode2(stp_vars_t *v,		/* I - Print file or command */
 }
 
 
+/*
+ * Offsets and counts that don't fit in a command byte are continued in
+ * following bytes, each added in; a byte of 255 means another follows.
+ */
+
+static unsigned char *
+pcl_delta_extend(unsigned char *out, int value)
+{
+  while (value >= 255)
+    {
+      *out++ = 255;
+      value -= 255;
+    }
+  *out++ = value;
+  return out;
+}
+
+
+/*
+ * 'pcl_pack_mode3()' - Delta row compress a row against its seed row.
+ *
+ * Each command byte holds the number of bytes to replace (1-8) in the
+ * top three bits and the offset from the end of the last replacement
+ * in the low five.  Returns the length of the compressed data, which
+ * is zero if the row is the same as the seed row.
+ */
+
+static int
+pcl_pack_mode3(const unsigned char *line, const unsigned char *seed,
+	       int height, unsigned char *out)
+{
+  unsigned char *start = out;
+  int pos = 0;
+  int i = 0;
+
+  while (i < height)
+    {
+      int end, offset;
+      if (line[i] == seed[i])
+	{
+	  i++;
+	  continue;
+	}
+      end = i + 1;
+      while (end < height && end - i < 8 && line[end] != seed[end])
+	end++;
+      offset = i - pos;
+      *out++ = ((end - i - 1) << 5) | (offset < 31 ? offset : 31);
+      if (offset >= 31)
+	out = pcl_delta_extend(out, offset - 31);
+      memcpy(out, line + i, end - i);
+      out += end - i;
+      pos = i = end;
+    }
+  return out - start;
+}
+
+
+/*
+ * 'pcl_pack_mode9()' - Replacement delta row compress a row.
+ *
+ * Like mode 3, but a replacement is either literal (command byte
+ * 0 oooo ccc, count - 1) or a run of one byte (1 oo ccccc, count - 2),
+ * and both offset and count can be continued in following bytes.
+ */
+
+static int
+pcl_pack_mode9(const unsigned char *line, const unsigned char *seed,
+	       int height, unsigned char *out)
+{
+  unsigned char *start = out;
+  int pos = 0;
+  int i = 0;
+
+  while (i < height)
+    {
+      int end;
+      if (line[i] == seed[i])
+	{
+	  i++;
+	  continue;
+	}
+      end = i + 1;
+      while (end < height && line[end] != seed[end])
+	end++;
+      while (i < end)
+	{
+	  int offset = i - pos;
+	  int run = 1;
+	  while (i + run < end && line[i + run] == line[i])
+	    run++;
+	  if (run >= 3)
+	    {
+	      *out++ = 0x80 | ((offset < 3 ? offset : 3) << 5) |
+		(run - 2 < 31 ? run - 2 : 31);
+	      if (offset >= 3)
+		out = pcl_delta_extend(out, offset - 3);
+	      if (run - 2 >= 31)
+		out = pcl_delta_extend(out, run - 2 - 31);
+	      *out++ = line[i];
+	      i += run;
+	    }
+	  else
+	    {
+	      int lit_end = i + run;
+	      while (lit_end < end &&
+		     !(lit_end + 2 < end && line[lit_end] == line[lit_end + 1] &&
+		       line[lit_end] == line[lit_end + 2]))
+		lit_end++;
+	      *out++ = ((offset < 15 ? offset : 15) << 3) |
+		(lit_end - i - 1 < 7 ? lit_end - i - 1 : 7);
+	      if (offset >= 15)
+		out = pcl_delta_extend(out, offset - 15);
+	      if (lit_end - i - 1 >= 7)
+		out = pcl_delta_extend(out, lit_end - i - 1 - 7);
+	      memcpy(out, line + i, lit_end - i);
+	      out += lit_end - i;
+	      i = lit_end;
+	    }
+	  pos = i;
+	}
+    }
+  return out - start;
+}
+
+
+/*
+ * 'pcl_mode_delta()' - Send PCL graphics using whichever of mode 2 (TIFF),
+ * mode 3 (delta row) and mode 9 (replacement delta row) is smallest.
+ *
+ * Each plane has its own seed row, the last row sent in that plane in
+ * any mode.  The planes of a row are held back until the last one, so
+ * that the whole row goes out in one mode.
+ */
+
+static const int pcl_delta_modes[3] = { 2, 3, 9 };
+
+static void
+pcl_mode_delta(stp_vars_t *v,		/* I - Print file or command */
+	       unsigned char *line,	/* I - Output bitmap data */
+	       int           height,	/* I - Height of bitmap data */
+	       int           last_plane) /* I - True if this is the last plane */
+{
+  pcl_privdata_t *pd =
+    (pcl_privdata_t *) stp_get_component_data(v, "Driver");
+  int plane = pd->delta_plane;
+  unsigned char *seed = pd->seed_rows + plane * pd->height;
+  unsigned char *out = pd->delta_buf + plane * 3 * pd->delta_buf_size;
+  unsigned char *comp_ptr;
+  int best_mode = 0;
+  int best_len = -1;
+  int i, j;
+
+  stp_pack_tiff(v, line, height, out, &comp_ptr, NULL, NULL);
+  pd->delta_len[plane][0] = comp_ptr - out;
+  pd->delta_len[plane][1] =
+    pcl_pack_mode3(line, seed, height, out + pd->delta_buf_size);
+  if (pd->delta_modes > 2)
+    pd->delta_len[plane][2] =
+      pcl_pack_mode9(line, seed, height, out + 2 * pd->delta_buf_size);
+  memcpy(seed, line, height);
+
+  if (!last_plane && plane < PCL_MAX_PLANES - 1)
+    {
+      pd->delta_plane++;
+      return;
+    }
+
+  for (i = 0; i < pd->delta_modes; i++)
+    {
+      int len = pcl_delta_modes[i] == pd->comp_mode ? 0 : 5;
+      for (j = 0; j <= plane; j++)
+	len += pd->delta_len[j][i];
+      if (best_len < 0 || len < best_len)
+	{
+	  best_len = len;
+	  best_mode = i;
+	}
+    }
+  if (pcl_delta_modes[best_mode] != pd->comp_mode)
+    {
+      pd->comp_mode = pcl_delta_modes[best_mode];
+      stp_zprintf(v, "\033*b%dM", pd->comp_mode);
+    }
+  for (j = 0; j <= plane; j++)
+    {
+      int len = pd->delta_len[j][best_mode];
+      stp_zprintf(v, "\033*b%d%c", len, j == plane ? 'W' : 'V');
+      stp_zfwrite((const char *) pd->delta_buf +
+		  (j * 3 + best_mode) * pd->delta_buf_size, len, 1, v);
+    }
+  pd->delta_plane = 0;
+}
+
+
 static stp_family_t print_pcl_module_data =
   {
     &print_pcl_printfuncs,
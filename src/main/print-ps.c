@@ -58,8 +58,30 @@ static stp_mxml_node_t *m_ppd = NULL;
  * Local functions...
  */
 
-static void	ps_hex(const stp_vars_t *, unsigned short *, int);
-static void	ps_ascii85(const stp_vars_t *, unsigned short *, int, int);
+/*
+ * Image data is collected in an output buffer and written in large
+ * blocks rather than a character at a time.  The ASCII85 encoder carries
+ * partial groups from one call to the next, so the data fed to it need
+ * not come in multiples of four bytes.
+ */
+
+#define PS_OUTBUF_SIZE 16384
+
+typedef struct
+{
+  unsigned char buf[PS_OUTBUF_SIZE + 16];
+  int outp;
+  int column;
+  unsigned char group[4];
+  int ngroup;
+} ps_encoder_t;
+
+static void	ps_narrow(const unsigned short *, unsigned char *, int, int);
+static void	ps_hex(const stp_vars_t *, ps_encoder_t *,
+		       const unsigned char *, int);
+static void	ps_ascii85(const stp_vars_t *, ps_encoder_t *,
+			   const unsigned char *, int);
+static void	ps_ascii85_finish(const stp_vars_t *, ps_encoder_t *);
 
 static const stp_parameter_t the_parameters[] =
 {
@@ -986,9 +1008,9 @@ ps_print_internal(stp_vars_t *v, stp_image_t *image)
 		paper_height;	/* Height of physical page */
   int		out_width,	/* Width of image on page */
 		out_height,	/* Height of image on page */
-		out_channels,	/* Output bytes per pixel */
-		out_ps_height,	/* Output height (Level 2 output) */
-		out_offset;	/* Output offset (Level 2 output) */
+		out_channels;	/* Output bytes per pixel */
+  unsigned char	*row;		/* Row narrowed to 8 bits */
+  ps_encoder_t	*encoder;	/* Output buffer and ASCII85 state */
   time_t	curtime;	/* Current time of day */
   unsigned	zero_mask;
   int           image_height,
@@ -1098,6 +1120,9 @@ ps_print_internal(stp_vars_t *v, stp_image_t *image)
 
   out_channels = stp_color_init(v, image, 256);
 
+  encoder = stp_zalloc(sizeof(ps_encoder_t));
+  row = stp_malloc(image_width * out_channels);
+
   if (model == 0)
   {
     stp_zprintf(v, "/picture %d string def\n", image_width * out_channels);
@@ -1122,28 +1147,22 @@ ps_print_internal(stp_vars_t *v, stp_image_t *image)
 	}
 
       out = stp_channel_get_input(v);
-
-      /* Convert from KCMY to CMYK */
-      if (cmyk_out)
-	{
-	  int x;
-	  unsigned short *pos = out;
-	  for (x = 0; x < image_width; x++, pos += 4)
-	    {
-	      unsigned short p0 = pos[0];
-	      pos[0] = pos[1];
-	      pos[1] = pos[2];
-	      pos[2] = pos[3];
-	      pos[3] = p0;
-	    }
-	}
-      ps_hex(v, out, image_width * out_channels);
+      ps_narrow(out, row, image_width * out_channels, cmyk_out);
+      ps_hex(v, encoder, row, image_width * out_channels);
     }
   }
   else
   {
-    unsigned short *tmp_buf =
-      stp_malloc(sizeof(unsigned short) * (image_width * out_channels + 4));
+    /*
+     * Level 2 output is run-length encoded before it is ASCII85 encoded.
+     * Literal runs cost one byte in 128, so there is no need to decide
+     * up front whether the page will compress.
+     */
+    int row_size = image_width * out_channels;
+    unsigned char *rle_buf = stp_malloc(row_size + (row_size + 127) / 128 + 2);
+    unsigned char *rle_end;
+    static const unsigned char rle_eod = 128;
+
     if (cmyk_out)
       stp_puts("/DeviceCMYK setcolorspace\n", v);
     else if (color_out)
@@ -1165,7 +1184,7 @@ ps_print_internal(stp_vars_t *v, stp_image_t *image)
     else
       stp_puts("\t/Decode [ 0 1 ]\n", v);
 
-    stp_puts("\t/DataSource currentfile /ASCII85Decode filter\n", v);
+    stp_puts("\t/DataSource currentfile /ASCII85Decode filter /RunLengthDecode filter\n", v);
 
     if ((image_width * 72 / out_width) < 100)
       stp_puts("\t/Interpolate true\n", v);
@@ -1175,59 +1194,24 @@ ps_print_internal(stp_vars_t *v, stp_image_t *image)
     stp_puts(">>\n", v);
     stp_puts("image\n", v);
 
-    for (y = 0, out_offset = 0; y < image_height; y ++)
+    for (y = 0; y < image_height; y ++)
     {
-      unsigned short *where;
-      /* FIXME!!! */
-      if (stp_color_get_row(v, image, y /*, out + out_offset */ , &zero_mask))
+      if (stp_color_get_row(v, image, y, &zero_mask))
 	{
 	  status = 2;
 	  break;
 	}
       out = stp_channel_get_input(v);
-      if (out_offset > 0)
-	{
-	  memcpy(tmp_buf + out_offset, out,
-		 image_width * out_channels * sizeof(unsigned short));
-	  where = tmp_buf;
-	}
-      else
-	where = out;
-
-      /* Convert from KCMY to CMYK */
-      if (cmyk_out)
-	{
-	  int x;
-	  unsigned short *pos = where;
-	  for (x = 0; x < image_width; x++, pos += 4)
-	    {
-	      unsigned short p0 = pos[0];
-	      pos[0] = pos[1];
-	      pos[1] = pos[2];
-	      pos[2] = pos[3];
-	      pos[3] = p0;
-	    }
-	}
-
-      out_ps_height = out_offset + image_width * out_channels;
-
-      if (y < (image_height - 1))
-      {
-	ps_ascii85(v, where, out_ps_height & ~3, 0);
-        out_offset = out_ps_height & 3;
-      }
-      else
-      {
-        ps_ascii85(v, where, out_ps_height, 1);
-        out_offset = 0;
-      }
-
-      if (out_offset > 0)
-        memcpy(tmp_buf, where + out_ps_height - out_offset,
-	       out_offset * sizeof(unsigned short));
+      ps_narrow(out, row, row_size, cmyk_out);
+      stp_pack_tiff(v, row, row_size, rle_buf, &rle_end, NULL, NULL);
+      ps_ascii85(v, encoder, rle_buf, rle_end - rle_buf);
     }
-    stp_free(tmp_buf);
+    ps_ascii85(v, encoder, &rle_eod, 1);
+    ps_ascii85_finish(v, encoder);
+    stp_free(rle_buf);
   }
+  stp_free(row);
+  stp_free(encoder);
   stp_image_conclude(image);
 
   stp_puts("grestore\n", v);
@@ -1264,14 +1248,49 @@ ps_print(const stp_vars_t *v, stp_image_t *image)
 }
 
 
+/*
+ * 'ps_narrow()' - Reduce 16-bit samples to bytes, reordering KCMY to CMYK.
+ */
+
+static void
+ps_narrow(const unsigned short *data,	/* I - 16-bit samples */
+	  unsigned char        *out,	/* O - 8-bit samples */
+	  int                  length,	/* I - Number of samples */
+	  int                  cmyk)	/* I - Convert KCMY to CMYK? */
+{
+  int i;
+  if (cmyk)
+    for (i = 0; i < length; i += 4)
+      {
+	out[i] = data[i + 1] >> 8;
+	out[i + 1] = data[i + 2] >> 8;
+	out[i + 2] = data[i + 3] >> 8;
+	out[i + 3] = data[i] >> 8;
+      }
+  else
+    for (i = 0; i < length; i++)
+      out[i] = data[i] >> 8;
+}
+
+
+static inline void
+ps_flush(const stp_vars_t *v, ps_encoder_t *enc)
+{
+  if (enc->outp)
+    stp_zfwrite((const char *) enc->buf, enc->outp, 1, v);
+  enc->outp = 0;
+}
+
+
 /*
  * 'ps_hex()' - Print binary data as a series of hexadecimal numbers.
  */
 
 static void
-ps_hex(const stp_vars_t *v,	/* I - File to print to */
-       unsigned short   *data,	/* I - Data to print */
-       int              length)	/* I - Number of bytes to print */
+ps_hex(const stp_vars_t    *v,	/* I - File to print to */
+       ps_encoder_t        *enc,	/* I - Output buffer */
+       const unsigned char *data,	/* I - Data to print */
+       int                 length)	/* I - Number of bytes to print */
 {
   int		col;		/* Current column */
   static const char	*hex = "0123456789ABCDEF";
@@ -1279,14 +1298,10 @@ ps_hex(const stp_vars_t *v,	/* I - File to print to */
   col = 0;
   while (length > 0)
   {
-    unsigned char pixel = (*data & 0xff00) >> 8;
-   /*
-    * Put the hex chars out to the file; note that we don't use stp_zprintf()
-    * for speed reasons...
-    */
+    unsigned char pixel = *data;
 
-    stp_putc(hex[pixel >> 4], v);
-    stp_putc(hex[pixel & 15], v);
+    enc->buf[enc->outp++] = hex[pixel >> 4];
+    enc->buf[enc->outp++] = hex[pixel & 15];
 
     data ++;
     length --;
@@ -1295,12 +1310,15 @@ ps_hex(const stp_vars_t *v,	/* I - File to print to */
     if (col >= 72)
     {
       col = 0;
-      stp_putc('\n', v);
+      enc->buf[enc->outp++] = '\n';
     }
+    if (enc->outp >= PS_OUTBUF_SIZE)
+      ps_flush(v, enc);
   }
 
   if (col > 0)
-    stp_putc('\n', v);
+    enc->buf[enc->outp++] = '\n';
+  ps_flush(v, enc);
 }
 
 
@@ -1309,90 +1327,112 @@ ps_hex(const stp_vars_t *v,	/* I - File to print to */
  */
 
 static void
-ps_ascii85(const stp_vars_t *v,	/* I - File to print to */
-	   unsigned short *data,	/* I - Data to print */
-	   int            length,	/* I - Number of bytes to print */
-	   int            last_line)	/* I - Last line of raster data? */
+ps_ascii85(const stp_vars_t    *v,	/* I - File to print to */
+	   ps_encoder_t        *enc,	/* I - Output buffer and state */
+	   const unsigned char *data,	/* I - Data to print */
+	   int                 length)	/* I - Number of bytes to print */
 {
-  int		i;			/* Looping var */
   unsigned	b;			/* Binary data word */
-  unsigned char	c[5];			/* ASCII85 encoded chars */
-  static int	column = 0;		/* Current column */
+  unsigned char	*c;			/* ASCII85 encoded chars */
 
-#define OUTBUF_SIZE 4096
-  unsigned char outbuffer[OUTBUF_SIZE+10];
-  int outp=0;
+  /*
+   * Finish any group left over from the last call first.
+   */
+  while (enc->ngroup > 0 && enc->ngroup < 4 && length > 0)
+    {
+      enc->group[enc->ngroup++] = *data++;
+      length--;
+    }
+  if (enc->ngroup == 4)
+    {
+      enc->ngroup = 0;
+      ps_ascii85(v, enc, enc->group, 4);
+    }
 
   while (length > 3)
   {
-    unsigned char d0 = (data[0] & 0xff00) >> 8;
-    unsigned char d1 = (data[1] & 0xff00) >> 8;
-    unsigned char d2 = (data[2] & 0xff00) >> 8;
-    unsigned char d3 = (data[3] & 0xff00) >> 8;
-    b = (((((d0 << 8) | d1) << 8) | d2) << 8) | d3;
+    b = (((((data[0] << 8) | data[1]) << 8) | data[2]) << 8) | data[3];
 
     if (b == 0)
     {
-      outbuffer[outp++]='z';
-      column ++;
+      enc->buf[enc->outp++] = 'z';
+      enc->column ++;
     }
     else
     {
-      outbuffer[outp+4] = (b % 85) + '!';
+      c = enc->buf + enc->outp;
+      c[4] = (b % 85) + '!';
       b /= 85;
-      outbuffer[outp+3] = (b % 85) + '!';
+      c[3] = (b % 85) + '!';
       b /= 85;
-      outbuffer[outp+2] = (b % 85) + '!';
+      c[2] = (b % 85) + '!';
       b /= 85;
-      outbuffer[outp+1] = (b % 85) + '!';
+      c[1] = (b % 85) + '!';
       b /= 85;
-      outbuffer[outp] = b + '!';
+      c[0] = b + '!';
 
-      outp+=5;
-      column += 5;
+      enc->outp += 5;
+      enc->column += 5;
     }
 
-    if (column > 72)
+    if (enc->column > 72)
     {
-      outbuffer[outp++]='\n';
-      column = 0;
+      enc->buf[enc->outp++] = '\n';
+      enc->column = 0;
     }
 
-    if(outp>=OUTBUF_SIZE)
-	{
-		stp_zfwrite((const char *)outbuffer, outp, 1, v);
-		outp=0;
-	}
+    if (enc->outp >= PS_OUTBUF_SIZE)
+      ps_flush(v, enc);
 
     data += 4;
     length -= 4;
   }
 
-  if(outp)
-    stp_zfwrite((const char *)outbuffer, outp, 1, v);
-
-  if (last_line)
-  {
-    if (length > 0)
+  while (length > 0)
     {
-      for (b = 0, i = length; i > 0; b = (b << 8) | data[0], data ++, i --);
+      enc->group[enc->ngroup++] = *data++;
+      length--;
+    }
+}
 
-      c[4] = (b % 85) + '!';
-      b /= 85;
-      c[3] = (b % 85) + '!';
-      b /= 85;
-      c[2] = (b % 85) + '!';
-      b /= 85;
-      c[1] = (b % 85) + '!';
-      b /= 85;
-      c[0] = b + '!';
 
-      stp_zfwrite((const char *)c, length + 1, 1, v);
-    }
+/*
+ * 'ps_ascii85_finish()' - Print any partial group and the end marker.
+ */
 
-    stp_puts("~>\n", v);
-    column = 0;
+static void
+ps_ascii85_finish(const stp_vars_t *v,	/* I - File to print to */
+		  ps_encoder_t     *enc)	/* I - Output buffer and state */
+{
+  if (enc->ngroup > 0)
+  {
+    /*
+     * A final partial group is padded with zeros, and only as many
+     * characters as there were bytes plus one are written.
+     */
+    unsigned b = 0;
+    unsigned char c[5];
+    int i;
+    for (i = 0; i < 4; i++)
+      b = (b << 8) | (i < enc->ngroup ? enc->group[i] : 0);
+
+    c[4] = (b % 85) + '!';
+    b /= 85;
+    c[3] = (b % 85) + '!';
+    b /= 85;
+    c[2] = (b % 85) + '!';
+    b /= 85;
+    c[1] = (b % 85) + '!';
+    b /= 85;
+    c[0] = b + '!';
+
+    memcpy(enc->buf + enc->outp, c, enc->ngroup + 1);
+    enc->outp += enc->ngroup + 1;
+    enc->ngroup = 0;
   }
+  ps_flush(v, enc);
+  stp_puts("~>\n", v);
+  enc->column = 0;
 }
 
 
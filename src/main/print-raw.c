@@ -43,6 +43,7 @@
 #include <gutenprint/gutenprint-intl-internal.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef __GNUC__
 #define inline __inline__
@@ -220,6 +221,93 @@ raw_describe_output(const stp_vars_t *v)
   return "RGB";
 }
 
+/*
+ * With Raw color correction, input that is already in the color model
+ * and depth being written comes out exactly as it went in.  Those rows
+ * can be copied straight from the image, without going through the
+ * color and channel code at all.  The entries are keyed on the output
+ * type and channel rotation of the ink type in use: CMYK input comes
+ * out as KCMY and is rotated back to CMYK, but with no rotation it
+ * stays KCMY, so only KCMY input passes through then.
+ */
+
+static const struct
+{
+  const char *input_type;
+  const char *output_type;
+  int rotate_channels;
+} passthrough_types[] =
+{
+  { "RGB", "RGB", 0 },
+  { "CMY", "CMY", 0 },
+  { "CMYK", "KCMY", 1 },
+  { "KCMY", "KCMY", 0 },
+  { "Whitescale", "Whitescale", 0 },
+  { "Grayscale", "Grayscale", 0 },
+};
+
+static const int passthrough_count =
+sizeof(passthrough_types) / sizeof(passthrough_types[0]);
+
+#define RAW_OUTBUF_SIZE (1024 * 1024)
+
+static int
+raw_can_pass_through(const stp_vars_t *v, const ink_t *ink, int bits)
+{
+  const char *correction = stp_get_string_parameter(v, "ColorCorrection");
+  const char *input_type = stp_get_string_parameter(v, "InputImageType");
+  const char *depth = stp_get_string_parameter(v, "ChannelBitDepth");
+  int i;
+  if (!correction || strcmp(correction, "Raw") != 0 ||
+      !input_type || !depth || atoi(depth) != bits)
+    return 0;
+  /* For the test suite, to compare against the full conversion */
+  if (stp_check_boolean_parameter(v, "STPIRawNoPassThrough",
+				  STP_PARAMETER_ACTIVE) &&
+      stp_get_boolean_parameter(v, "STPIRawNoPassThrough"))
+    return 0;
+  for (i = 0; i < passthrough_count; i++)
+    if (strcmp(input_type, passthrough_types[i].input_type) == 0 &&
+	strcmp(ink->output_type, passthrough_types[i].output_type) == 0 &&
+	ink->rotate_channels == passthrough_types[i].rotate_channels)
+      return 1;
+  return 0;
+}
+
+static int
+raw_pass_through(stp_vars_t *v, stp_image_t *image, int width, int height,
+		 int row_bytes)
+{
+  int rows_per_buf = RAW_OUTBUF_SIZE / row_bytes;
+  unsigned char *buf;
+  int rows = 0;
+  int status = 1;
+  int y;
+  if (rows_per_buf < 1)
+    rows_per_buf = 1;
+  if (rows_per_buf > height)
+    rows_per_buf = height;
+  buf = stp_malloc(row_bytes * rows_per_buf);
+  for (y = 0; y < height; y++)
+    {
+      if (stp_image_get_row(image, buf + rows * row_bytes, row_bytes, y) !=
+	  STP_IMAGE_STATUS_OK)
+	{
+	  status = 2;
+	  break;
+	}
+      if (++rows == rows_per_buf)
+	{
+	  stp_zfwrite((char *) buf, rows * row_bytes, 1, v);
+	  rows = 0;
+	}
+    }
+  if (rows)
+    stp_zfwrite((char *) buf, rows * row_bytes, 1, v);
+  stp_free(buf);
+  return status;
+}
+
 static int
 raw_print(const stp_vars_t *v, stp_image_t *image)
 {
@@ -260,6 +348,16 @@ raw_print(const stp_vars_t *v, stp_image_t *image)
 	    stp_set_string_parameter(nv, "STPIOutputType", inks[i].output_type);
 	    ink_channels = inks[i].output_channels;
 	    rotate_output = inks[i].rotate_channels;
+	    if (raw_can_pass_through(nv, &(inks[i]), bytes_per_channel * 8))
+	      {
+		stp_dprintf(STP_DBG_COLORFUNC, nv, "raw: passing %s through\n",
+			    ink_type);
+		status = raw_pass_through(nv, image, width, height,
+					  width * ink_channels * bytes_per_channel);
+		stp_image_conclude(image);
+		stp_vars_destroy(nv);
+		return status;
+	      }
 	    break;
 	  }
     }
@@ -282,8 +380,8 @@ raw_print(const stp_vars_t *v, stp_image_t *image)
       return 0;
     }
 
-  if (out_channels != ink_channels)
-    final_out = stp_malloc(width * ink_channels * 2);
+  /* The channel data is left alone; anything rewritten goes here */
+  final_out = stp_malloc(width * ink_channels * 2);
 
   for (y = 0; y < height; y++)
     {
@@ -299,15 +397,17 @@ raw_print(const stp_vars_t *v, stp_image_t *image)
       real_out = out;
       if (rotate_output)
 	{
-	  unsigned short *tmp_out = real_out;
+	  const unsigned short *in_out = out;
+	  unsigned short *tmp_out = final_out;
 	  for (i = 0; i < width; i++)
 	    {
-	      unsigned short tmp = tmp_out[0];
 	      for (j = 0; j < ink_channels - 1; j++)
-		tmp_out[j] = tmp_out[j + 1];
-	      tmp_out[ink_channels - 1] = tmp;
+		tmp_out[j] = in_out[j + 1];
+	      tmp_out[ink_channels - 1] = in_out[0];
+	      in_out += ink_channels;
 	      tmp_out += ink_channels;
 	    }
+	  real_out = final_out;
 	}
       if (out_channels != ink_channels)
 	{
@@ -333,16 +433,16 @@ raw_print(const stp_vars_t *v, stp_image_t *image)
 	}
       if (bytes_per_channel == 1)
 	{
-	  unsigned char *char_out = (unsigned char *) real_out;
+	  unsigned char *char_out = (unsigned char *) final_out;
 	  for (i = 0; i < width * ink_channels; i++)
 	    char_out[i] = real_out[i] / 257;
+	  real_out = final_out;
 	}
       stp_zfwrite((char *) real_out,
 		  width * ink_channels * bytes_per_channel, 1, nv);
     }
   stp_image_conclude(image);
-  if (final_out)
-    stp_free(final_out);
+  stp_free(final_out);
   stp_vars_destroy(nv);
   return status;
 }
@@ -0,0 +1,234 @@
+/*
+ *
+ *   Worker threads shared by the whole library
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Revision History:
+ *
+ *   See ChangeLog
+ */
+
+/*
+ * Work that splits into independent pieces (bands of a row, tiles of a
+ * dither pass) is handed to stpi_run_tasks() as a count of numbered
+ * tasks.  The calling thread takes part, and the call returns once
+ * every task is done.  Each task must write only its own part of the
+ * output, and anything that has to be combined is combined by the
+ * caller in task order afterwards, so the result is the same whichever
+ * thread ran which task, and the same as running them all inline.
+ *
+ * The pool is off (one thread, the caller's) unless it is asked for
+ * with stp_set_thread_count() or the STP_THREADS environment variable.
+ * Its threads are started the first time there is work for them.  Only
+ * one set of tasks runs on the pool at a time; a second caller, or a
+ * task that itself asks for tasks, runs them inline.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <gutenprint/gutenprint.h>
+#include "gutenprint-internal.h"
+#include <gutenprint/gutenprint-intl-internal.h>
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/*
+ * thread_count is only changed holding both pool_batch and pool_lock,
+ * so holding either one is enough to read it.
+ */
+static int thread_count = 0;	/* 0 until first asked for */
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t pool_batch = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_t *pool_threads = NULL;
+static int pool_size = 0;	/* Threads started, not counting the caller */
+static int pool_shutdown = 0;
+static unsigned pool_generation = 0;
+static stpi_task_func_t *pool_func;
+static void *pool_data;
+static int pool_ntasks;
+static int pool_next_task;
+static int pool_tasks_done;
+#endif
+
+static void
+run_tasks_inline(int ntasks, stpi_task_func_t *func, void *data)
+{
+  int i;
+  for (i = 0; i < ntasks; i++)
+    (func)(data, i);
+}
+
+/*
+ * The count asked for in the environment, if stp_set_thread_count()
+ * hasn't been called.
+ */
+static int
+env_thread_count(void)
+{
+  const char *threads = getenv("STP_THREADS");
+  int count = threads ? atoi(threads) : 1;
+  return count < 1 ? 1 : count;
+}
+
+#ifdef HAVE_PTHREAD
+/*
+ * Grab and run tasks until there are none left.  Called with the lock
+ * held, and returns with it held.
+ */
+static void
+run_tasks_locked(void)
+{
+  while (pool_next_task < pool_ntasks)
+    {
+      int task = pool_next_task++;
+      pthread_mutex_unlock(&pool_lock);
+      (pool_func)(pool_data, task);
+      pthread_mutex_lock(&pool_lock);
+      if (++pool_tasks_done == pool_ntasks)
+	pthread_cond_signal(&pool_done);
+    }
+}
+
+static void *
+pool_thread(void *arg)
+{
+  unsigned generation;
+  (void) arg;
+  pthread_mutex_lock(&pool_lock);
+  generation = pool_generation;
+  while (1)
+    {
+      while (!pool_shutdown && pool_generation == generation)
+	pthread_cond_wait(&pool_work, &pool_lock);
+      if (pool_shutdown)
+	break;
+      generation = pool_generation;
+      run_tasks_locked();
+    }
+  pthread_mutex_unlock(&pool_lock);
+  return NULL;
+}
+
+/*
+ * Start count - 1 threads.  Called holding pool_batch, so nothing is
+ * running on the pool.
+ */
+static void
+start_pool(int count)
+{
+  pool_threads = stp_zalloc(sizeof(pthread_t) * count);
+  pool_shutdown = 0;
+  for (pool_size = 0; pool_size < count - 1; pool_size++)
+    if (pthread_create(&(pool_threads[pool_size]), NULL, pool_thread, NULL))
+      break;
+}
+
+/*
+ * Stop the threads and free everything.  Called holding pool_batch.
+ */
+static void
+stop_pool(void)
+{
+  int i;
+  if (!pool_threads)
+    return;
+  pthread_mutex_lock(&pool_lock);
+  pool_shutdown = 1;
+  pthread_cond_broadcast(&pool_work);
+  pthread_mutex_unlock(&pool_lock);
+  for (i = 0; i < pool_size; i++)
+    pthread_join(pool_threads[i], NULL);
+  STP_SAFE_FREE(pool_threads);
+  pool_size = 0;
+}
+#endif
+
+void
+stp_set_thread_count(int count)
+{
+  if (count < 1)
+    count = 1;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&pool_batch);
+  if (pool_threads && count != pool_size + 1)
+    stop_pool();
+  pthread_mutex_lock(&pool_lock);
+  thread_count = count;
+  pthread_mutex_unlock(&pool_lock);
+  pthread_mutex_unlock(&pool_batch);
+#else
+  thread_count = count;
+#endif
+}
+
+int
+stp_get_thread_count(void)
+{
+#ifdef HAVE_PTHREAD
+  int count;
+  pthread_mutex_lock(&pool_lock);
+  if (thread_count == 0)
+    thread_count = env_thread_count();
+  count = thread_count;
+  pthread_mutex_unlock(&pool_lock);
+  return count;
+#else
+  return 1;
+#endif
+}
+
+void
+stpi_run_tasks(int ntasks, stpi_task_func_t *func, void *data)
+{
+  if (ntasks <= 0)
+    return;
+#ifdef HAVE_PTHREAD
+  if (ntasks > 1 && stp_get_thread_count() > 1 &&
+      pthread_mutex_trylock(&pool_batch) == 0)
+    {
+      /* thread_count is set by now, and can't change while we hold
+	 pool_batch */
+      if (!pool_threads)
+	start_pool(thread_count);
+      if (pool_size > 0)
+	{
+	  pthread_mutex_lock(&pool_lock);
+	  pool_func = func;
+	  pool_data = data;
+	  pool_ntasks = ntasks;
+	  pool_next_task = 0;
+	  pool_tasks_done = 0;
+	  pool_generation++;
+	  pthread_cond_broadcast(&pool_work);
+	  run_tasks_locked();
+	  while (pool_tasks_done < pool_ntasks)
+	    pthread_cond_wait(&pool_done, &pool_lock);
+	  pthread_mutex_unlock(&pool_lock);
+	}
+      else
+	run_tasks_inline(ntasks, func, data);
+      pthread_mutex_unlock(&pool_batch);
+      return;
+    }
+#endif
+  run_tasks_inline(ntasks, func, data);
+}
@@ -0,0 +1,173 @@
+/*
+ *   Check that Hybrid Fast dithering keeps the right density when masked
+ *   and unmasked rows are mixed.  Masked rows go through the general
+ *   error diffusion code, so this catches the two paths disagreeing
+ *   about the error they hand each other.
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <gutenprint/gutenprint.h>
+#define STPI_TESTDITHER
+
+#include "../src/main/gutenprint-internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH		1440
+#define HEIGHT		256
+#define LENGTH		((WIDTH + 7) / 8)
+
+int global_test_count = 0;
+int global_error_count = 0;
+
+static const stp_dotsize_t single_dotsize[] =
+{
+  { 0x1, 1.0 }
+};
+
+static const stp_shade_t normal_1bit_shades[] =
+{
+  { 1.0, 1, single_dotsize }
+};
+
+static int
+image_width(stp_image_t *image)
+{
+  return WIDTH;
+}
+
+static stp_image_t theImage =
+{
+  NULL,
+  NULL,
+  image_width,
+  NULL,
+  NULL,
+  NULL,
+};
+
+static void
+errfunc(void *file, const char *buf, size_t bytes)
+{
+  fwrite(buf, 1, bytes, stderr);
+}
+
+static int
+count_bits(const unsigned char *line)
+{
+  int i, count = 0;
+  for (i = 0; i < LENGTH; i++)
+    {
+      unsigned char c = line[i];
+      for (; c; c &= c - 1)
+	count++;
+    }
+  return count;
+}
+
+/*
+ * Dither a flat gray page, masking every mask_period'th row (never, if
+ * mask_period is 0), and record the dots printed on each row.
+ */
+static void
+dither_page(const char *algorithm, unsigned short level, int mask_period,
+	    int *counts)
+{
+  unsigned char black[LENGTH];
+  unsigned char mask[LENGTH];
+  unsigned short gray[WIDTH];
+  stp_vars_t *v;
+  int i;
+
+  v = stp_vars_create();
+  stp_set_driver(v, "escp2-ex");
+  stp_set_errfunc(v, errfunc);
+  stp_set_errdata(v, stderr);
+  stp_set_string_parameter(v, "DitherAlgorithm", algorithm);
+  stp_set_string_parameter(v, "ChannelBitDepth", "8");
+  stp_set_string_parameter(v, "PrintingMode", "BW");
+  stp_set_string_parameter(v, "InputImageType", "Grayscale");
+  stp_dither_init(v, &theImage, WIDTH, 1, 1);
+  stp_dither_add_channel(v, black, STP_ECOLOR_K, 0);
+  stp_dither_set_inks_full(v, STP_ECOLOR_K, 1, normal_1bit_shades, 1.0, 1.0);
+  stp_dither_set_ink_spread(v, 13);
+
+  memset(mask, 0xff, sizeof(mask));
+  for (i = 0; i < WIDTH; i++)
+    gray[i] = level;
+  for (i = 0; i < HEIGHT; i++)
+    {
+      int masked = mask_period && (i % mask_period) == 0;
+      memset(black, 0, sizeof(black));
+      stp_dither_internal(v, i, gray, 0, 0, masked ? mask : NULL);
+      counts[i] = count_bits(black);
+    }
+  stp_vars_destroy(v);
+}
+
+/*
+ * The error carried from row to row must mean the same whichever code
+ * dithered the row, so each row prints close to the ink it was given,
+ * masked or not.  If either path misreads the other's error, the rows
+ * after a switch come out far too light or far too dark.
+ */
+static void
+run_test(unsigned short level, int mask_period)
+{
+  int counts[HEIGHT];
+  double expected = (double) level * WIDTH / 65535;
+  double total = 0;
+  int worst = 0;
+  int i;
+
+  global_test_count++;
+  dither_page("HybridFast", level, mask_period, counts);
+  /* The first rows are still building up error */
+  for (i = 8; i < HEIGHT; i++)
+    {
+      int off = abs(counts[i] - (int) (expected + .5));
+      total += counts[i];
+      if (off > worst)
+	worst = off;
+    }
+  total /= HEIGHT - 8;
+  if (worst > WIDTH / 20 || total < expected * .97 || total > expected * 1.03)
+    {
+      printf("FAIL: level %u, masking every %d rows: expected %.1f dots/row, got %.1f, worst row off by %d\n",
+	     level, mask_period, expected, total, worst);
+      global_error_count++;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+  static const unsigned short levels[] = { 0x800, 0x2000, 0x5555, 0x8000, 0xc000 };
+  static const int periods[] = { 0, 2, 3, 7 };
+  int i, j;
+  stp_init();
+  for (i = 0; i < (int) (sizeof(levels) / sizeof(levels[0])); i++)
+    for (j = 0; j < (int) (sizeof(periods) / sizeof(periods[0])); j++)
+      run_test(levels[i], periods[j]);
+  if (global_error_count)
+    printf("%d/%d tests FAILED.\n", global_error_count, global_test_count);
+  else
+    printf("All %d tests passed successfully.\n", global_test_count);
+  return global_error_count ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/*
+ *   Check that the raw driver's pass-through path writes the same bytes
+ *   as the full color conversion.
+ *
+ *   This program is free software; you can redistribute it and/or modify it
+ *   under the terms of the GNU General Public License as published by the Free
+ *   Software Foundation; either version 2 of the License, or (at your option)
+ *   any later version.
+ *
+ *   This program is distributed in the hope that it will be useful, but
+ *   WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *   or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *   for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gutenprint/gutenprint.h>
+
+#define WIDTH 67
+#define HEIGHT 5
+
+int global_test_count = 0;
+int global_error_count = 0;
+
+typedef struct
+{
+  int bytes_per_pixel;
+  int bits;
+} image_rep_t;
+
+typedef struct
+{
+  char *data;
+  size_t bytes;
+} output_t;
+
+static const struct
+{
+  const char *name;
+  int channels;
+} input_types[] =
+{
+  { "Whitescale", 1 },
+  { "Grayscale", 1 },
+  { "RGB", 3 },
+  { "CMY", 3 },
+  { "CMYK", 4 },
+  { "KCMY", 4 },
+};
+
+static const int input_type_count = sizeof(input_types) / sizeof(input_types[0]);
+
+static void
+image_init(stp_image_t *image)
+{
+}
+
+static void
+image_reset(stp_image_t *image)
+{
+}
+
+static int
+image_width(stp_image_t *image)
+{
+  return WIDTH;
+}
+
+static int
+image_height(stp_image_t *image)
+{
+  return HEIGHT;
+}
+
+/*
+ * Every byte different, and covering the whole range, so that any
+ * reordering or rescaling of channels shows up.
+ */
+static stp_image_status_t
+image_get_row(stp_image_t *image, unsigned char *data, size_t byte_limit,
+	      int row)
+{
+  const image_rep_t *rep = (const image_rep_t *) image->rep;
+  size_t i;
+  if (byte_limit < (size_t) (WIDTH * rep->bytes_per_pixel))
+    return STP_IMAGE_STATUS_ABORT;
+  if (rep->bits == 16)
+    {
+      unsigned short *sdata = (unsigned short *) data;
+      for (i = 0; i < byte_limit / 2; i++)
+	sdata[i] = (unsigned short) ((i * 40503 + row * 7919) & 0xffff);
+    }
+  else
+    for (i = 0; i < byte_limit; i++)
+      data[i] = (unsigned char) ((i * 37 + row * 11) & 0xff);
+  return STP_IMAGE_STATUS_OK;
+}
+
+static const char *
+image_get_appname(stp_image_t *image)
+{
+  return "raw-passthrough";
+}
+
+static void
+image_conclude(stp_image_t *image)
+{
+}
+
+static void
+writefunc(void *data, const char *buf, size_t bytes)
+{
+  output_t *out = (output_t *) data;
+  out->data = realloc(out->data, out->bytes + bytes);
+  memcpy(out->data + out->bytes, buf, bytes);
+  out->bytes += bytes;
+}
+
+static void
+errfunc(void *data, const char *buf, size_t bytes)
+{
+  fwrite(buf, 1, bytes, stderr);
+}
+
+static int
+print_one(const stp_vars_t *tv, int channels, int bits, int full,
+	  output_t *out)
+{
+  stp_vars_t *v = stp_vars_create_copy(tv);
+  image_rep_t rep;
+  stp_image_t image =
+    {
+      image_init, image_reset, image_width, image_height, image_get_row,
+      image_get_appname, image_conclude, NULL
+    };
+  int status;
+  rep.bytes_per_pixel = channels * bits / 8;
+  rep.bits = bits;
+  image.rep = &rep;
+  out->data = NULL;
+  out->bytes = 0;
+  stp_set_outfunc(v, writefunc);
+  stp_set_outdata(v, out);
+  if (full)
+    stp_set_boolean_parameter(v, "STPIRawNoPassThrough", 1);
+  status = stp_print(v, &image);
+  stp_vars_destroy(v);
+  return status;
+}
+
+static void
+run_test(const char *driver, const char *ink_type, int input, int bits)
+{
+  const stp_printer_t *printer = stp_get_printer_by_driver(driver);
+  stp_vars_t *v = stp_vars_create();
+  output_t pass, full;
+  char depth[8];
+  int pass_status, full_status;
+
+  stp_set_driver(v, driver);
+  stp_set_errfunc(v, errfunc);
+  stp_set_outfunc(v, writefunc);
+  stp_set_printer_defaults(v, printer);
+  stp_set_page_width(v, WIDTH);
+  stp_set_page_height(v, HEIGHT);
+  stp_set_width(v, WIDTH);
+  stp_set_height(v, HEIGHT);
+  stp_set_string_parameter(v, "InkType", ink_type);
+  stp_set_string_parameter(v, "ColorCorrection", "Raw");
+  stp_set_string_parameter(v, "InputImageType", input_types[input].name);
+  sprintf(depth, "%d", bits);
+  stp_set_string_parameter(v, "ChannelBitDepth", depth);
+
+  global_test_count++;
+  pass_status = print_one(v, input_types[input].channels, bits, 0, &pass);
+  full_status = print_one(v, input_types[input].channels, bits, 1, &full);
+  if (pass_status != full_status || pass.bytes != full.bytes ||
+      (pass.bytes && memcmp(pass.data, full.data, pass.bytes) != 0))
+    {
+      printf("FAIL: %s %s %s %d bit: status %d/%d, %lu/%lu bytes\n",
+	     driver, ink_type, input_types[input].name, bits,
+	     pass_status, full_status, (unsigned long) pass.bytes,
+	     (unsigned long) full.bytes);
+      global_error_count++;
+    }
+  free(pass.data);
+  free(full.data);
+  stp_vars_destroy(v);
+}
+
+int
+main(int argc, char **argv)
+{
+  static const char *drivers[] = { "raw-data-8", "raw-data-16" };
+  int i;
+  stp_init();
+  for (i = 0; i < 2; i++)
+    {
+      stp_parameter_t desc;
+      const stp_printer_t *printer = stp_get_printer_by_driver(drivers[i]);
+      int j;
+      if (!printer)
+	{
+	  printf("FAIL: no printer %s\n", drivers[i]);
+	  return 1;
+	}
+      stp_describe_parameter(stp_printer_get_defaults(printer), "InkType",
+			     &desc);
+      for (j = 0; j < stp_string_list_count(desc.bounds.str); j++)
+	{
+	  const char *ink_type = stp_string_list_param(desc.bounds.str, j)->name;
+	  int k;
+	  for (k = 0; k < input_type_count; k++)
+	    {
+	      run_test(drivers[i], ink_type, k, 8);
+	      run_test(drivers[i], ink_type, k, 16);
+	    }
+	}
+      stp_parameter_description_destroy(&desc);
+    }
+  if (global_error_count)
+    printf("%d/%d tests FAILED.\n", global_error_count, global_test_count);
+  else
+    printf("All %d tests passed successfully.\n", global_test_count);
+  return global_error_count ? 1 : 0;
+}